@@ -0,0 +1,138 @@
+#ifndef KKI_UTIL_ARENA_H
+#define KKI_UTIL_ARENA_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace kki
+{
+    // Monotonic allocator for short lived strings and containers
+    // Memory is handed out by bumping a pointer through large blocks and is only given back all at once,
+    // reset() rewinds to the first block in O(1) and keeps every block for the next round
+    // Not thread safe, nothing allocated from the arena may be used after reset() or destruction
+    class string_arena{
+    public:
+        static const size_t default_block_size = 1 << 16;
+
+        explicit string_arena(size_t block_size = default_block_size) : _block_size(block_size){}
+        string_arena(const string_arena&) = delete;
+        string_arena& operator=(const string_arena&) = delete;
+        ~string_arena(){
+            while (_first != nullptr){
+                block* next = _first->next;
+                ::operator delete(_first);
+                _first = next;
+            }
+        }
+
+        // Return: size bytes aligned to alignment, a power of two
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)){
+            assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+            char* p = align(_current, alignment);
+            if (_current == nullptr || size > static_cast<size_t>(_limit - p)){
+                next_block(size + alignment - 1);
+                p = align(_current, alignment);
+            }
+            _current = p + size;
+            return p;
+        }
+
+        // Everything allocated so far is released at once, the blocks are kept
+        void reset(){
+            _block = _first;
+            _current = _first == nullptr ? nullptr : bytes(_first);
+            _limit = _first == nullptr ? nullptr : bytes(_first) + _first->size;
+        }
+
+        // Return: bytes held by the arena's blocks
+        size_t capacity() const{
+            size_t res = 0;
+            for (block* b = _first; b != nullptr; b = b->next){
+                res += b->size;
+            }
+            return res;
+        }
+
+    private:
+        struct block{
+            block* next;
+            size_t size;
+        };
+
+        static char* bytes(block* b){
+            return reinterpret_cast<char*>(b + 1);
+        }
+        static char* align(char* p, size_t alignment){
+            const uintptr_t address = reinterpret_cast<uintptr_t>(p);
+            return p + ((alignment - address % alignment) % alignment);
+        }
+
+        // Moves to the next kept block if it has room for size bytes, otherwise a new block is linked in after the current one
+        void next_block(size_t size){
+            block* next = _block == nullptr ? _first : _block->next;
+            if (next == nullptr || next->size < size){
+                const size_t block_size = std::max(_block_size, size);
+                block* b = static_cast<block*>(::operator new(sizeof(block) + block_size));
+                b->size = block_size;
+                b->next = next;
+                if (_block == nullptr){
+                    _first = b;
+                }
+                else{
+                    _block->next = b;
+                }
+                next = b;
+            }
+            _block = next;
+            _current = bytes(next);
+            _limit = _current + next->size;
+        }
+
+        size_t _block_size;
+        block* _first{nullptr};
+        block* _block{nullptr};
+        char* _current{nullptr};
+        char* _limit{nullptr};
+    };
+
+    // Standard allocator handing out memory from a string_arena, deallocation is a no-op
+    template<typename T>
+    class arena_allocator{
+    public:
+        using value_type = T;
+
+        arena_allocator(string_arena& arena) : _arena(&arena){}
+        template<typename T_other>
+        arena_allocator(const arena_allocator<T_other>& other) : _arena(other.arena()){}
+
+        T* allocate(size_t n){
+            return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T*, size_t){}
+
+        string_arena* arena() const{
+            return _arena;
+        }
+
+        template<typename T_other>
+        bool operator==(const arena_allocator<T_other>& other) const{
+            return _arena == other.arena();
+        }
+        template<typename T_other>
+        bool operator!=(const arena_allocator<T_other>& other) const{
+            return _arena != other.arena();
+        }
+
+    private:
+        string_arena* _arena;
+    };
+
+    template<typename T>
+    using arena_vector = std::vector<T, arena_allocator<T>>;
+}
+
+#endif //KKI_UTIL_ARENA_H
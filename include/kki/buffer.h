@@ -0,0 +1,435 @@
+#ifndef KKI_UTIL_BUFFER_H
+#define KKI_UTIL_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <new>
+#include "arena.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define KKI_MMAP
+#else
+#include <cstdio>
+#endif
+
+namespace kki
+{
+    // ======================== //
+    // Reference count policies //
+    // ======================== //
+
+    // Default, buffers can be shared between threads
+    class atomic_count{
+    public:
+        explicit atomic_count(size_t count) : _count(count){}
+        void increment(){
+            _count.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Return: true if the last reference was released
+        bool decrement(){
+            return _count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+        size_t load() const{
+            return _count.load(std::memory_order_relaxed);
+        }
+        // Acquire pairs with the release of the other references,
+        // so their accesses to the chars happen before anything the caller writes next
+        bool unique() const{
+            return _count.load(std::memory_order_acquire) == 1;
+        }
+
+    private:
+        std::atomic<size_t> _count;
+    };
+
+    // Copies and slices of strings confined to one thread skip the atomic instructions
+    class plain_count{
+    public:
+        explicit plain_count(size_t count) : _count(count){}
+        void increment(){
+            ++_count;
+        }
+        bool decrement(){
+            return --_count == 0;
+        }
+        size_t load() const{
+            return _count;
+        }
+        bool unique() const{
+            return _count == 1;
+        }
+
+    private:
+        size_t _count;
+    };
+
+    // Defining KKI_STRING_SINGLE_THREADED makes every buffer use the plain count,
+    // it has to be defined the same way in every translation unit of a program
+#if defined(KKI_STRING_SINGLE_THREADED)
+    using buffer_count = plain_count;
+#else
+    using buffer_count = atomic_count;
+#endif
+
+    // Defining KKI_COUNT_ALLOCATIONS makes buffers count their heap allocations, see buffer::allocations()
+    // Without it nothing is counted and allocating costs nothing extra
+
+    // Expected access pattern of a mapped file, passed on to madvise
+    enum class access_hint{
+        normal,
+        sequential,
+        random
+    };
+
+    // Reference counted char buffer in a single allocation
+    // The reference count (see buffer_count), size and capacity are stored in a header right in front of the chars,
+    // so creating a buffer is one allocation and reaching the chars is one pointer away
+    // Copies share the chars, growing past the capacity moves only the growing handle to a new allocation
+    // Buffers created with an arena allocate from it, including when they grow, and are never freed on their own
+    // Mapped files keep only the header on the heap, the mapping is private so writes never reach the file
+    class buffer{
+    public:
+        buffer() = default;
+        // Allocates an empty buffer
+        explicit buffer(size_t capacity) : _header(allocate(capacity, nullptr)){}
+        buffer(size_t capacity, string_arena& arena) : _header(allocate(capacity, &arena)){}
+        buffer(const char* data, size_t len) : buffer(data, len, len){}
+        // Copies len chars into a buffer with room for capacity chars
+        buffer(const char* data, size_t len, size_t capacity) : _header(allocate(capacity, nullptr)){
+            assign(data, len);
+        }
+        buffer(const char* data, size_t len, size_t capacity, string_arena& arena) : _header(allocate(capacity, &arena)){
+            assign(data, len);
+        }
+
+        // Maps the whole file, the mapping is released with the last handle
+        // Return: empty handle if the file cannot be opened or is empty
+        static buffer map_file(const char* path, access_hint hint = access_hint::normal);
+
+        buffer(const buffer& other) noexcept : _header(other._header){
+            acquire();
+        }
+        buffer(buffer&& other) noexcept : _header(other._header){
+            other._header = nullptr;
+        }
+        buffer& operator=(const buffer& other) noexcept{
+            // Acquire first so assigning a buffer to itself keeps it alive
+            other.acquire();
+            release();
+            _header = other._header;
+            return *this;
+        }
+        buffer& operator=(buffer&& other) noexcept{
+            if (this != &other){
+                release();
+                _header = other._header;
+                other._header = nullptr;
+            }
+            return *this;
+        }
+        ~buffer(){
+            release();
+        }
+
+        explicit operator bool() const{
+            return _header != nullptr;
+        }
+        void reset(){
+            release();
+            _header = nullptr;
+        }
+        // Return: number of handles sharing the chars, 0 for an empty handle
+        // Only a snapshot, use unique() to decide whether the chars may be written
+        size_t use_count() const{
+            return _header == nullptr ? 0 : _header->refs.load();
+        }
+        // Return: true if this is the only handle, the chars can then be written without racing former owners
+        bool unique() const{
+            return _header != nullptr && _header->refs.unique();
+        }
+        // Return: heap allocations made by all buffers so far, always 0 unless KKI_COUNT_ALLOCATIONS is defined
+        static size_t allocations(){
+            return allocation_count().load(std::memory_order_relaxed);
+        }
+
+        // ========= //
+        // Accessors //
+        // ========= //
+
+        inline char* data(){
+            return _header->data;
+        }
+        inline const char* data() const{
+            return _header->data;
+        }
+        inline size_t size() const{
+            return _header->size;
+        }
+        inline size_t capacity() const{
+            return _header->capacity;
+        }
+        inline bool empty() const{
+            return size() == 0;
+        }
+        inline char* begin(){
+            return data();
+        }
+        inline char* end(){
+            return data() + size();
+        }
+        inline const char* begin() const{
+            return data();
+        }
+        inline const char* end() const{
+            return data() + size();
+        }
+        inline char& operator[](size_t i){
+            assert(i < size());
+            return data()[i];
+        }
+        inline char operator[](size_t i) const{
+            assert(i < size());
+            return data()[i];
+        }
+        inline char& back(){
+            assert(size() != 0);
+            return data()[size() - 1];
+        }
+
+        // Hash of the chars cached by the strings spanning the whole buffer, 0 if none is cached
+        // The modifying members reset it, writes through data() have to call reset_hash()
+        size_t cached_hash() const{
+            return _header->hash.load(std::memory_order_relaxed);
+        }
+        void cache_hash(size_t hash) const{
+            _header->hash.store(hash, std::memory_order_relaxed);
+        }
+        void reset_hash(){
+            cache_hash(0);
+        }
+
+        // ============ //
+        // Modification //
+        // ============ //
+
+        // Moves the chars to an allocation with room for at least capacity chars
+        void reserve(size_t capacity){
+            if (capacity > _header->capacity){
+                reallocate(capacity);
+            }
+        }
+        // Drops the unused capacity
+        void shrink_to_fit(){
+            if (_header->capacity != _header->size){
+                reallocate(_header->size);
+            }
+        }
+        // New chars are zero
+        void resize(size_t len){
+            grow(len);
+            if (len > _header->size){
+                std::fill(end(), data() + len, '\0');
+            }
+            _header->size = len;
+            reset_hash();
+        }
+        void clear(){
+            _header->size = 0;
+            reset_hash();
+        }
+
+        void push_back(char c){
+            grow(size() + 1);
+            data()[_header->size++] = c;
+            reset_hash();
+        }
+        // data must not point into this buffer
+        void append(const char* data, size_t len){
+            grow(size() + len);
+            std::copy(data, data + len, end());
+            _header->size += len;
+            reset_hash();
+        }
+        void append(size_t n, char c){
+            grow(size() + n);
+            std::fill_n(end(), n, c);
+            _header->size += n;
+            reset_hash();
+        }
+        // Adds n chars without initializing them
+        // Return: pointer to the first of them
+        char* expand(size_t n){
+            grow(size() + n);
+            char* res = end();
+            _header->size += n;
+            reset_hash();
+            return res;
+        }
+        // Inserts [first, last) before pos, the range must not point into this buffer
+        void insert(size_t pos, const char* first, const char* last){
+            assert(pos <= size());
+            const size_t len = last - first;
+            grow(size() + len);
+            std::copy_backward(data() + pos, end(), end() + len);
+            std::copy(first, last, data() + pos);
+            _header->size += len;
+            reset_hash();
+        }
+        // Removes [first, last)
+        void erase(size_t first, size_t last){
+            assert(first <= last && last <= size());
+            std::copy(data() + last, end(), data() + first);
+            _header->size -= last - first;
+            reset_hash();
+        }
+
+    private:
+        struct header{
+            buffer_count refs;
+            size_t size;
+            size_t capacity;
+            // Right after the header, unless the buffer maps a file
+            char* data;
+            // Written by readers on any thread, so it is atomic under either count policy
+            std::atomic<size_t> hash;
+            // nullptr for buffers on the heap
+            string_arena* arena;
+        };
+
+        static std::atomic<size_t>& allocation_count(){
+            static std::atomic<size_t> res{0};
+            return res;
+        }
+
+        static header* allocate(size_t capacity, string_arena* arena){
+            const size_t bytes = sizeof(header) + capacity;
+#if defined(KKI_COUNT_ALLOCATIONS)
+            if (arena == nullptr){
+                allocation_count().fetch_add(1, std::memory_order_relaxed);
+            }
+#endif
+            header* h = static_cast<header*>(arena == nullptr ? ::operator new(bytes) : arena->allocate(bytes, alignof(header)));
+            new (&h->refs) buffer_count(1);
+            new (&h->hash) std::atomic<size_t>(0);
+            h->size = 0;
+            h->capacity = capacity;
+            h->data = chars(h);
+            h->arena = arena;
+            return h;
+        }
+        static char* chars(header* h){
+            return reinterpret_cast<char*>(h + 1);
+        }
+
+        void acquire() const{
+            if (_header != nullptr){
+                _header->refs.increment();
+            }
+        }
+        void release(){
+            if (_header != nullptr && _header->refs.decrement()){
+                _header->refs.~buffer_count();
+                _header->hash.~atomic();
+                if (_header->arena == nullptr){
+                    if (_header->data != chars(_header)){
+                        unmap(_header->data, _header->capacity);
+                    }
+                    ::operator delete(_header);
+                }
+            }
+        }
+
+        // Makes room for len chars, the capacity at least doubles so appends are amortized O(1)
+        void grow(size_t len){
+            if (len > _header->capacity){
+                reallocate(std::max(len, _header->capacity * 2));
+            }
+        }
+        void reallocate(size_t capacity){
+            header* h = allocate(capacity, _header->arena);
+            h->size = std::min(_header->size, capacity);
+            if (h->size != 0){
+                std::memcpy(h->data, data(), h->size);
+            }
+            release();
+            _header = h;
+        }
+
+        void assign(const char* data, size_t len){
+            assert(len <= _header->capacity);
+            std::copy(data, data + len, _header->data);
+            _header->size = len;
+        }
+
+        static void unmap(char* data, size_t len){
+#if defined(KKI_MMAP)
+            munmap(data, len);
+#else
+            (void)data;
+            (void)len;
+#endif
+        }
+
+        header* _header{nullptr};
+    };
+
+    inline buffer buffer::map_file(const char* path, access_hint hint){
+#if defined(KKI_MMAP)
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0){
+            return {};
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || info.st_size <= 0){
+            close(fd);
+            return {};
+        }
+        const size_t len = static_cast<size_t>(info.st_size);
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid after the descriptor is closed
+        close(fd);
+        if (p == MAP_FAILED){
+            return {};
+        }
+        if (hint == access_hint::sequential){
+            madvise(p, len, MADV_SEQUENTIAL);
+        }
+        else if (hint == access_hint::random){
+            madvise(p, len, MADV_RANDOM);
+        }
+        header* h = allocate(0, nullptr);
+        h->data = static_cast<char*>(p);
+        h->size = len;
+        h->capacity = len;
+        buffer res;
+        res._header = h;
+        return res;
+#else
+        // Without mmap the file is read into a heap buffer
+        (void)hint;
+        FILE* file = std::fopen(path, "rb");
+        if (file == nullptr){
+            return {};
+        }
+        buffer res(0);
+        char chunk[1 << 16];
+        size_t read;
+        while ((read = std::fread(chunk, 1, sizeof(chunk), file)) != 0){
+            res.append(chunk, read);
+        }
+        std::fclose(file);
+        if (res.empty()){
+            return {};
+        }
+        return res;
+#endif
+    }
+}
+
+#endif //KKI_UTIL_BUFFER_H
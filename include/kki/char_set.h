@@ -0,0 +1,265 @@
+#ifndef KKI_UTIL_CHAR_SET_H
+#define KKI_UTIL_CHAR_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include "simd.h"
+
+namespace kki
+{
+    // Set of bytes stored as a 256 bit bitmap, usable in constant expressions
+    // The bitmap is laid out as two 16 byte nibble tables so a block of text is classified with byte shuffles:
+    //  - byte (c & 0x80) >> 3 | (c & 0x0f) holds the members sharing the low nibble and the highest bit of c
+    //  - bit (c >> 4) & 7 of that byte is set if c is a member
+    class char_set{
+    public:
+        constexpr char_set() = default;
+        // Every byte of the null terminated chars is a member
+        constexpr char_set(const char* chars){
+            for (; *chars != '\0'; ++chars){
+                add(*chars);
+            }
+        }
+        constexpr char_set(const char* chars, size_t len){
+            for (size_t i = 0; i < len; ++i){
+                add(chars[i]);
+            }
+        }
+
+        constexpr char_set& add(char c){
+            if (!contains(c)){
+                if (_size < listed){
+                    _list[_size] = c;
+                }
+                ++_size;
+                _bits[index(c)] |= bit(c);
+            }
+            return *this;
+        }
+        // Adds every byte in [first, last]
+        constexpr char_set& add_range(char first, char last){
+            for (unsigned c = static_cast<unsigned char>(first); c <= static_cast<unsigned char>(last); ++c){
+                add(static_cast<char>(c));
+            }
+            return *this;
+        }
+
+        constexpr bool contains(char c) const{
+            return (_bits[index(c)] & bit(c)) != 0;
+        }
+        constexpr size_t size() const{
+            return _size;
+        }
+        constexpr bool empty() const{
+            return _size == 0;
+        }
+
+        constexpr char_set operator|(const char_set& other) const{
+            char_set res = *this;
+            for (unsigned c = 0; c < 256; ++c){
+                if (other.contains(static_cast<char>(c))){
+                    res.add(static_cast<char>(c));
+                }
+            }
+            return res;
+        }
+        constexpr char_set operator~() const{
+            char_set res;
+            for (unsigned c = 0; c < 256; ++c){
+                if (!contains(static_cast<char>(c))){
+                    res.add(static_cast<char>(c));
+                }
+            }
+            return res;
+        }
+        constexpr bool operator==(const char_set& other) const{
+            for (size_t i = 0; i < 32; ++i){
+                if (_bits[i] != other._bits[i]){
+                    return false;
+                }
+            }
+            return true;
+        }
+        constexpr bool operator!=(const char_set& other) const{
+            return !(*this == other);
+        }
+
+        // ======= //
+        // Presets //
+        // ======= //
+
+        // Same members as isspace in the C locale
+        static constexpr char_set whitespace(){
+            return char_set(" \t\n\v\f\r");
+        }
+        static constexpr char_set digits(){
+            return char_set().add_range('0', '9');
+        }
+        static constexpr char_set letters(){
+            return char_set().add_range('a', 'z').add_range('A', 'Z');
+        }
+        static constexpr char_set alphanumeric(){
+            return letters() | digits();
+        }
+
+        // ====== //
+        // Search //
+        // ====== //
+
+        // Return: first member in [start, end), or end
+        const char* find(const char* start, const char* end) const{
+            return find_first<false>(start, end);
+        }
+        // Return: first non member in [start, end), or end
+        const char* find_not(const char* start, const char* end) const{
+            return find_first<true>(start, end);
+        }
+        // Return: last member in [start, end), or nullptr
+        const char* find_last(const char* start, const char* end) const{
+            return find_last<false>(start, end);
+        }
+        // Return: last non member in [start, end), or nullptr
+        const char* find_last_not(const char* start, const char* end) const{
+            return find_last<true>(start, end);
+        }
+
+    private:
+        // Members kept in a list for SIMD builds without byte shuffles
+        static const size_t listed = 8;
+
+        static constexpr size_t index(char c){
+            return (static_cast<unsigned char>(c) & 0x80) >> 3 | (static_cast<unsigned char>(c) & 0x0f);
+        }
+        static constexpr uint8_t bit(char c){
+            return static_cast<uint8_t>(1u << ((static_cast<unsigned char>(c) >> 4) & 7));
+        }
+
+#if defined(KKI_SIMD)
+        // Classifies a vector of text at a time, the tables stay in registers for a whole search
+        class matcher{
+        public:
+            explicit matcher(const char_set& set);
+
+            // Return: bit i is set if byte i at p is a member
+            simd::mask operator()(const char* p) const;
+
+            // False if the build cannot classify this set with vectors
+            bool usable() const{
+                return _usable;
+            }
+
+        private:
+            bool _usable{true};
+#if defined(KKI_SIMD_SHUFFLE)
+            simd::vector _low;
+            simd::vector _high;
+            simd::vector _bits;
+            simd::vector _sign;
+#else
+            simd::vector _members[listed];
+            size_t _count{0};
+#endif
+        };
+#endif
+
+        template<bool T_negate>
+        const char* find_first(const char* start, const char* end) const;
+        template<bool T_negate>
+        const char* find_last(const char* start, const char* end) const;
+
+        uint8_t _bits[32]{};
+        char _list[listed]{};
+        size_t _size{0};
+    };
+
+#if defined(KKI_SIMD)
+    inline char_set::matcher::matcher(const char_set& set){
+#if defined(KKI_SIMD_SHUFFLE)
+        static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        _low = simd::load_table(set._bits);
+        _high = simd::load_table(set._bits + 16);
+        _bits = simd::load_table(bits);
+        _sign = simd::splat(static_cast<char>(0x80));
+#else
+        // Without shuffles only small sets are classified with one comparison per member
+        _usable = set._size <= listed;
+        if (_usable){
+            for (; _count < set._size; ++_count){
+                _members[_count] = simd::splat(set._list[_count]);
+            }
+        }
+#endif
+    }
+
+    inline simd::mask char_set::matcher::operator()(const char* p) const{
+        const simd::vector text = simd::load(p);
+#if defined(KKI_SIMD_SHUFFLE)
+        // Bytes below 0x80 index the low table, the others the high table, the shuffle zeroes the unused side
+        const simd::vector low_indices = simd::bit_and(text, simd::splat(static_cast<char>(0x8f)));
+        const simd::vector high_indices = simd::bit_xor(low_indices, _sign);
+        const simd::vector row = simd::bit_or(simd::shuffle(_low, low_indices), simd::shuffle(_high, high_indices));
+        const simd::vector bit = simd::shuffle(_bits, simd::high_nibbles(text));
+        return simd::equal(simd::bit_and(row, bit), bit);
+#else
+        simd::vector res = simd::zero();
+        for (size_t i = 0; i < _count; ++i){
+            res = simd::bit_or(res, simd::equal_bytes(text, _members[i]));
+        }
+        return simd::to_mask(res);
+#endif
+    }
+#endif
+
+    template<bool T_negate>
+    inline const char* char_set::find_first(const char* start, const char* end) const{
+        const char* current = start;
+#if defined(KKI_SIMD)
+        const matcher match(*this);
+        if (match.usable()){
+            for (; static_cast<size_t>(end - current) >= simd::width; current += simd::width){
+                simd::mask m = match(current);
+                if (T_negate){
+                    m = ~m & simd::full;
+                }
+                if (m != 0){
+                    return current + simd::lowest_bit(m);
+                }
+            }
+        }
+#endif
+        for (; current != end; ++current){
+            if (contains(*current) != T_negate){
+                return current;
+            }
+        }
+        return end;
+    }
+
+    template<bool T_negate>
+    inline const char* char_set::find_last(const char* start, const char* end) const{
+        const char* current = end;
+#if defined(KKI_SIMD)
+        const matcher match(*this);
+        if (match.usable()){
+            for (; static_cast<size_t>(current - start) >= simd::width; current -= simd::width){
+                simd::mask m = match(current - simd::width);
+                if (T_negate){
+                    m = ~m & simd::full;
+                }
+                if (m != 0){
+                    return current - simd::width + simd::highest_bit(m);
+                }
+            }
+        }
+#endif
+        while (current != start){
+            --current;
+            if (contains(*current) != T_negate){
+                return current;
+            }
+        }
+        return nullptr;
+    }
+}
+
+#endif //KKI_UTIL_CHAR_SET_H
@@ -0,0 +1,145 @@
+#ifndef KKI_UTIL_CSV_READER_H
+#define KKI_UTIL_CSV_READER_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include "simd.h"
+#include "string.h"
+
+namespace kki
+{
+    // Reads the rows of a CSV or TSV text one at a time, the fields are slices of the text
+    // The text is classified 64 bytes at a time: quotes, delimiters and newlines become bitmasks,
+    // the prefix xor of the quotes marks the quoted bytes and the delimiters and newlines outside them end the fields
+    // Whether a block starts inside quotes is carried over from the previous block, so nothing is read twice
+    // Quoted fields lose their quotes and are only copied if they hold escaped ("") quotes,
+    // a '\r' ending a row is dropped, an empty text has no rows
+    // Works over any string, for large files over string::map_file, and holds no memory of its own
+    class csv_reader{
+    public:
+        explicit csv_reader(const string& text, char delimiter = ',', char quote = '"')
+            : _text(text), _delimiter(delimiter), _quote(quote){
+            assert(delimiter != quote && delimiter != '\n' && quote != '\n');
+            _current = _text.begin();
+            _block = _text.begin();
+            if (_block != _text.end()){
+                load_block();
+            }
+        }
+        // The positions point into the text, which may be stored inside the reader
+        csv_reader(const csv_reader&) = delete;
+        csv_reader& operator=(const csv_reader&) = delete;
+
+        // Fields of the next row, output is cleared first so a container reused across rows keeps its capacity
+        // Return: false if there are no more rows, output is left empty
+        template<typename T_container>
+        bool read_row(T_container& output){
+            output.clear();
+            if (_current == _text.end()){
+                return false;
+            }
+            while (true){
+                const char* separator = next_separator();
+                if (separator == _text.end() || *separator == '\n'){
+                    output.push_back(field(_current, separator, true));
+                    _current = separator == _text.end() ? separator : separator + 1;
+                    return true;
+                }
+                output.push_back(field(_current, separator, false));
+                _current = separator + 1;
+            }
+        }
+
+    private:
+        // Return: bit i is set if byte i of the len bytes at p is c
+        static uint64_t equal_mask(const char* p, size_t len, char c){
+            uint64_t res = 0;
+            for (size_t i = 0; i < len; ++i){
+                res |= static_cast<uint64_t>(p[i] == c) << i;
+            }
+            return res;
+        }
+
+        // Finds the delimiters and newlines outside quotes in the block at _block
+        void load_block(){
+            const size_t len = std::min<size_t>(simd::block, _text.end() - _block);
+            uint64_t quotes, separators;
+#if defined(KKI_SIMD)
+            if (len == simd::block){
+                quotes = simd::equal_block(_block, simd::splat(_quote));
+                separators = simd::equal_block(_block, simd::splat(_delimiter)) | simd::equal_block(_block, simd::splat('\n'));
+            }
+            else{
+                quotes = equal_mask(_block, len, _quote);
+                separators = equal_mask(_block, len, _delimiter) | equal_mask(_block, len, '\n');
+            }
+#else
+            quotes = equal_mask(_block, len, _quote);
+            separators = equal_mask(_block, len, _delimiter) | equal_mask(_block, len, '\n');
+#endif
+            // The opening quote and everything up to the closing one, "" inside a field toggles twice
+            const uint64_t quoted = simd::prefix_xor(quotes) ^ _inside_quotes;
+            _inside_quotes = 0 - (quoted >> 63);
+            _separators = separators & ~quoted;
+        }
+
+        // Return: next delimiter or newline outside quotes, end of the text if there is none
+        const char* next_separator(){
+            while (_separators == 0){
+                if (_text.end() - _block <= static_cast<std::ptrdiff_t>(simd::block)){
+                    return _text.end();
+                }
+                _block += simd::block;
+                load_block();
+            }
+            const char* res = _block + simd::lowest_bit(_separators);
+            _separators = simd::clear_lowest_bit(_separators);
+            return res;
+        }
+
+        // Return: the field in [first, last) without its quotes
+        string field(const char* first, const char* last, bool last_in_row) const{
+            if (last_in_row && last != first && last[-1] == '\r'){
+                --last;
+            }
+            if (last == first || *first != _quote){
+                return string(_text.container, first, last);
+            }
+            ++first;
+            if (last != first && last[-1] == _quote){
+                --last;
+            }
+            const char* escaped = string::find_ptr(first, last, _quote);
+            if (escaped == last){
+                return string(_text.container, first, last);
+            }
+            // Every "" stands for one quote
+            string_builder res(static_cast<size_t>(last - first));
+            while (escaped != last){
+                res.append(first, escaped - first + 1);
+                first = escaped + 1;
+                if (first != last && *first == _quote){
+                    ++first;
+                }
+                escaped = string::find_ptr(first, last, _quote);
+            }
+            res.append(first, last - first);
+            return std::move(res).to_string();
+        }
+
+        string _text;
+        char _delimiter;
+        char _quote;
+        // Start of the next field
+        const char* _current;
+        // Start of the block the separators are from
+        const char* _block;
+        // Separators of the block not yet returned
+        uint64_t _separators{0};
+        // All ones if the block after _block starts inside quotes
+        uint64_t _inside_quotes{0};
+    };
+}
+
+#endif //KKI_UTIL_CSV_READER_H
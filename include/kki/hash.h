@@ -0,0 +1,151 @@
+#ifndef KKI_UTIL_HASH_H
+#define KKI_UTIL_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace kki
+{
+    // Fast non cryptographic hash in the style of wyhash
+    // Reads the input 8 bytes at a time and folds every word pair with one 64 x 64 -> 128 bit multiplication,
+    // inputs of up to 16 bytes take a single multiplication before the final mix
+    // The same function is available at compile time, it assembles the words byte by byte and gives the same values
+    namespace hashing
+    {
+        static constexpr uint64_t secret0 = 0xa0761d6478bd642full;
+        static constexpr uint64_t secret1 = 0xe7037ed1a0b428dbull;
+        static constexpr uint64_t secret2 = 0x8ebc6af09c88c6e3ull;
+        static constexpr uint64_t secret3 = 0x589965cc75374cc3ull;
+
+        struct product{
+            uint64_t low;
+            uint64_t high;
+        };
+
+        // Return: full 128 bit product of a and b
+        constexpr product multiply(uint64_t a, uint64_t b){
+#if defined(__SIZEOF_INT128__)
+            const unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+            return {static_cast<uint64_t>(p), static_cast<uint64_t>(p >> 64)};
+#else
+            const uint64_t mask = 0xffffffffull;
+            const uint64_t low_low = (a & mask) * (b & mask);
+            const uint64_t high_low = (a >> 32) * (b & mask);
+            const uint64_t low_high = (a & mask) * (b >> 32);
+            const uint64_t high_high = (a >> 32) * (b >> 32);
+            const uint64_t cross = (low_low >> 32) + (high_low & mask) + low_high;
+            return {(cross << 32) | (low_low & mask), high_high + (high_low >> 32) + (cross >> 32)};
+#endif
+        }
+        constexpr uint64_t mix(uint64_t a, uint64_t b){
+            const product p = multiply(a, b);
+            return p.low ^ p.high;
+        }
+
+        // ======= //
+        // Readers //
+        // ======= //
+
+        // Little endian words assembled byte by byte, usable in constant expressions
+        struct byte_reader{
+            static constexpr uint64_t read(const char* p, size_t n){
+                uint64_t res = 0;
+                for (size_t i = 0; i < n; ++i){
+                    res |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+                }
+                return res;
+            }
+            static constexpr uint64_t read8(const char* p){
+                return read(p, 8);
+            }
+            static constexpr uint64_t read4(const char* p){
+                return read(p, 4);
+            }
+        };
+
+        // Unaligned loads, swapped on big endian targets so the values match byte_reader
+        struct word_reader{
+            static inline uint64_t read8(const char* p){
+                uint64_t res;
+                std::memcpy(&res, p, sizeof(res));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                res = __builtin_bswap64(res);
+#endif
+                return res;
+            }
+            static inline uint64_t read4(const char* p){
+                uint32_t res;
+                std::memcpy(&res, p, sizeof(res));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                res = __builtin_bswap32(res);
+#endif
+                return res;
+            }
+        };
+
+        // ==== //
+        // Hash //
+        // ==== //
+
+        template<typename T_reader>
+        constexpr uint64_t hash(const char* p, size_t len, uint64_t seed){
+            seed ^= mix(seed ^ secret0, secret1);
+            uint64_t a = 0, b = 0;
+            if (len <= 16){
+                if (len >= 4){
+                    // Two overlapping pairs of 4 byte reads cover 4 to 16 bytes
+                    const size_t middle = (len >> 3) << 2;
+                    a = (T_reader::read4(p) << 32) | T_reader::read4(p + middle);
+                    b = (T_reader::read4(p + len - 4) << 32) | T_reader::read4(p + len - 4 - middle);
+                }
+                else if (len > 0){
+                    a = (static_cast<uint64_t>(static_cast<unsigned char>(p[0])) << 16)
+                        | (static_cast<uint64_t>(static_cast<unsigned char>(p[len >> 1])) << 8)
+                        | static_cast<unsigned char>(p[len - 1]);
+                }
+            }
+            else{
+                size_t left = len;
+                if (left > 48){
+                    // Three independent lanes keep the multipliers busy
+                    uint64_t lane1 = seed, lane2 = seed;
+                    do{
+                        seed = mix(T_reader::read8(p) ^ secret1, T_reader::read8(p + 8) ^ seed);
+                        lane1 = mix(T_reader::read8(p + 16) ^ secret2, T_reader::read8(p + 24) ^ lane1);
+                        lane2 = mix(T_reader::read8(p + 32) ^ secret3, T_reader::read8(p + 40) ^ lane2);
+                        p += 48;
+                        left -= 48;
+                    } while (left > 48);
+                    seed ^= lane1 ^ lane2;
+                }
+                while (left > 16){
+                    seed = mix(T_reader::read8(p) ^ secret1, T_reader::read8(p + 8) ^ seed);
+                    p += 16;
+                    left -= 16;
+                }
+                // The last 16 bytes, overlapping what was already mixed
+                a = T_reader::read8(p + left - 16);
+                b = T_reader::read8(p + left - 8);
+            }
+            const product ab = multiply(a ^ secret1, b ^ seed);
+            return mix(ab.low ^ secret0 ^ len, ab.high ^ secret1);
+        }
+
+        // Runtime hash of len chars
+        inline size_t hash(const char* data, size_t len, uint64_t seed = 0){
+            return static_cast<size_t>(hash<word_reader>(data, len, seed));
+        }
+
+        // Compile time hash of a null terminated string, equal to hash(cstr, strlen(cstr))
+        constexpr size_t hash(const char* cstr){
+            size_t len = 0;
+            while (cstr[len] != '\0'){
+                ++len;
+            }
+            return static_cast<size_t>(hash<byte_reader>(cstr, len, 0));
+        }
+    }
+}
+
+#endif //KKI_UTIL_HASH_H
@@ -0,0 +1,112 @@
+#ifndef KKI_UTIL_LINE_READER_H
+#define KKI_UTIL_LINE_READER_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <istream>
+#include <vector>
+#include "buffer.h"
+#include "string.h"
+
+namespace kki
+{
+    // Reads a stream in large blocks and yields its lines as slices of the blocks, without copying them
+    // A line that continues past the end of a block is moved to the start of the next block,
+    // blocks are recycled once no line shares them anymore
+    // Lines are split on '\n' like std::getline, every reader is independent so readers on different threads do not interfere
+    class line_reader{
+    public:
+        static const size_t default_block_size = 1 << 16;
+
+        explicit line_reader(std::istream& stream, size_t block_size = default_block_size)
+            : _stream(stream), _block_size(std::max<size_t>(block_size, 1)){}
+
+        // Return: false if there are no more lines, line is left unchanged
+        bool getline(string& line){
+            const char* newline = _current == _end ? _end : string::find_ptr(_current, _end, '\n');
+            while (newline == _end){
+                const size_t scanned = _end - _current;
+                if (!refill()){
+                    // The last line has no newline
+                    if (_current == _end){
+                        return false;
+                    }
+                    line = string(_block, _current, _end);
+                    _current = _end;
+                    return true;
+                }
+                newline = string::find_ptr(_current + scanned, _end, '\n');
+            }
+            line = string(_block, _current, newline);
+            _current = newline + 1;
+            return true;
+        }
+
+    private:
+        // Retired blocks kept for recycling
+        static const size_t spare_blocks = 4;
+
+        // Moves the unfinished line to the start of a block with free space and reads more of the stream into it
+        // Return: false if nothing more could be read
+        bool refill(){
+            if (_eof){
+                return false;
+            }
+            const size_t tail = _end - _current;
+            buffer next = free_block(std::max(_block_size, tail * 2));
+            if (tail != 0){
+                std::memmove(next.data(), _current, tail);
+            }
+            if (_block && _block.data() != next.data()){
+                retire(std::move(_block));
+            }
+            _block = std::move(next);
+            _current = _block.data();
+            _end = _current + tail;
+
+            _stream.read(_block.data() + tail, static_cast<std::streamsize>(_block.size() - tail));
+            const size_t read = static_cast<size_t>(_stream.gcount());
+            _end += read;
+            _eof = !_stream;
+            return read != 0;
+        }
+
+        // Return: block of at least capacity bytes that no line shares
+        buffer free_block(size_t capacity){
+            // The current block is rewritten in place if all its lines are gone
+            if (_block && _block.unique() && _block.size() >= capacity){
+                return _block;
+            }
+            for (auto i = _spare.begin(); i != _spare.end(); ++i){
+                if (i->unique() && i->size() >= capacity){
+                    buffer res = std::move(*i);
+                    _spare.erase(i);
+                    return res;
+                }
+            }
+            // The stream is read straight into the block, so its bytes are left uninitialized
+            buffer res(capacity);
+            res.expand(capacity);
+            return res;
+        }
+
+        // Blocks still shared by lines stay alive through the lines, only the latest few are kept for reuse
+        void retire(buffer&& block){
+            if (_spare.size() == spare_blocks){
+                _spare.erase(_spare.begin());
+            }
+            _spare.push_back(std::move(block));
+        }
+
+        std::istream& _stream;
+        size_t _block_size;
+        bool _eof{false};
+        buffer _block;
+        std::vector<buffer> _spare;
+        const char* _current{nullptr};
+        const char* _end{nullptr};
+    };
+}
+
+#endif //KKI_UTIL_LINE_READER_H
@@ -0,0 +1,206 @@
+#ifndef KKI_UTIL_MULTI_SEARCH_H
+#define KKI_UTIL_MULTI_SEARCH_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "string.h"
+
+namespace kki
+{
+    // Aho-Corasick automaton matching any number of patterns in a single pass over the text
+    // The automaton is compiled into a DFA stored in one flat transition table:
+    //  - bytes are mapped to equivalence classes, only bytes that appear in the patterns get a class of their own
+    //  - transitions are stored premultiplied by the class count, so a step is one table lookup
+    //  - states with matches are numbered last, so checking for a match is one comparison
+    class multi_searcher{
+    public:
+        struct match{
+            size_t pattern;
+            size_t position;
+        };
+
+        // Patterns must not be empty, the pattern id is its index in the vector
+        explicit multi_searcher(const std::vector<string>& patterns){
+            build_classes(patterns);
+            build_automaton(patterns);
+        }
+
+        inline size_t patterns() const{
+            return _lengths.size();
+        }
+        inline size_t states() const{
+            return _transitions.size() / _class_count;
+        }
+
+        // ====== //
+        // Search //
+        // ====== //
+
+        // Calls callback(pattern id, position) for every match in [begin, end), including overlapping ones
+        // Matches are reported ordered by their end, positions are relative to begin
+        template<typename T_callback>
+        void find_all(const char* begin, const char* end, const T_callback& callback) const{
+            const uint32_t* transitions = _transitions.data();
+            const uint8_t* classes = _classes;
+            uint32_t state = 0;
+            for (const char* current = begin; current != end; ++current){
+                state = transitions[state + classes[static_cast<unsigned char>(*current)]];
+                if (state >= _first_match){
+                    // Only match states need their index
+                    const size_t index = (state - _first_match) / _class_count;
+                    const size_t match_end = current - begin + 1;
+                    for (uint32_t i = _match_offsets[index]; i != _match_offsets[index + 1]; ++i){
+                        const uint32_t pattern = _matches[i];
+                        callback(static_cast<size_t>(pattern), match_end - _lengths[pattern]);
+                    }
+                }
+            }
+        }
+        template<typename T_callback>
+        void find_all(const string& str, const T_callback& callback) const{
+            find_all(str.begin(), str.end(), callback);
+        }
+        template<typename T_callback>
+        void find_all(const string_builder& builder, const T_callback& callback) const{
+            find_all(builder.data(), builder.data() + builder.size(), callback);
+        }
+
+        std::vector<match> find_all(const char* begin, const char* end) const{
+            std::vector<match> res;
+            find_all(begin, end, [&res](size_t pattern, size_t position){
+                res.push_back({pattern, position});
+            });
+            return res;
+        }
+        std::vector<match> find_all(const string& str) const{
+            return find_all(str.begin(), str.end());
+        }
+        std::vector<match> find_all(const string_builder& builder) const{
+            return find_all(builder.data(), builder.data() + builder.size());
+        }
+
+    private:
+        // Every byte that appears in a pattern gets its own class, all the other bytes share one class
+        void build_classes(const std::vector<string>& patterns){
+            bool used[256]{};
+            for (const auto& pattern : patterns){
+                for (char c : pattern){
+                    used[static_cast<unsigned char>(c)] = true;
+                }
+            }
+            size_t count = 0;
+            for (size_t i = 0; i < 256; ++i){
+                if (used[i]){
+                    _classes[i] = static_cast<uint8_t>(count++);
+                }
+            }
+            for (size_t i = 0; i < 256; ++i){
+                if (!used[i]){
+                    _classes[i] = static_cast<uint8_t>(count);
+                }
+            }
+            _class_count = std::min<size_t>(count + 1, 256);
+        }
+
+        void build_automaton(const std::vector<string>& patterns){
+            const size_t k = _class_count;
+            const uint32_t none = static_cast<uint32_t>(-1);
+
+            // Trie, state 0 is the root
+            std::vector<uint32_t> trie(k, none);
+            std::vector<std::vector<uint32_t>> outputs(1);
+            _lengths.reserve(patterns.size());
+            for (size_t id = 0; id < patterns.size(); ++id){
+                const string& pattern = patterns[id];
+                assert(pattern.size() > 0);
+                size_t state = 0;
+                for (char c : pattern){
+                    uint32_t& next = trie[state * k + _classes[static_cast<unsigned char>(c)]];
+                    if (next == none){
+                        next = static_cast<uint32_t>(outputs.size());
+                        outputs.emplace_back();
+                        // next is invalidated by the resize
+                        trie.resize(trie.size() + k, none);
+                    }
+                    state = trie[state * k + _classes[static_cast<unsigned char>(c)]];
+                }
+                outputs[state].push_back(static_cast<uint32_t>(id));
+                _lengths.push_back(pattern.size());
+            }
+
+            // Breadth first over the trie, missing transitions are replaced by the transitions of the failure state
+            // The failure state is shallower, so its transitions and outputs are already complete
+            const size_t count = outputs.size();
+            std::vector<uint32_t> failure(count, 0);
+            std::vector<uint32_t> queue;
+            queue.reserve(count);
+            for (size_t c = 0; c < k; ++c){
+                uint32_t& next = trie[c];
+                if (next == none){
+                    next = 0;
+                }
+                else{
+                    queue.push_back(next);
+                }
+            }
+            for (size_t head = 0; head < queue.size(); ++head){
+                const uint32_t state = queue[head];
+                for (size_t c = 0; c < k; ++c){
+                    const uint32_t fallback = trie[failure[state] * k + c];
+                    uint32_t& next = trie[state * k + c];
+                    if (next == none){
+                        next = fallback;
+                    }
+                    else{
+                        failure[next] = fallback;
+                        auto& inherited = outputs[fallback];
+                        outputs[next].insert(outputs[next].end(), inherited.begin(), inherited.end());
+                        queue.push_back(next);
+                    }
+                }
+            }
+
+            // Renumber the states so the match states come last
+            std::vector<uint32_t> renumbered(count);
+            uint32_t next_id = 0;
+            for (size_t state = 0; state < count; ++state){
+                if (outputs[state].empty()){
+                    renumbered[state] = next_id++;
+                }
+            }
+            _first_match = next_id * static_cast<uint32_t>(k);
+            _match_offsets.reserve(count - next_id + 1);
+            _match_offsets.push_back(0);
+            for (size_t state = 0; state < count; ++state){
+                if (!outputs[state].empty()){
+                    renumbered[state] = next_id++;
+                    _matches.insert(_matches.end(), outputs[state].begin(), outputs[state].end());
+                    _match_offsets.push_back(static_cast<uint32_t>(_matches.size()));
+                }
+            }
+
+            // Flat transition table with premultiplied targets
+            _transitions.resize(count * k);
+            for (size_t state = 0; state < count; ++state){
+                const size_t row = renumbered[state] * k;
+                for (size_t c = 0; c < k; ++c){
+                    _transitions[row + c] = renumbered[trie[state * k + c]] * static_cast<uint32_t>(k);
+                }
+            }
+        }
+
+        uint8_t _classes[256]{};
+        size_t _class_count{1};
+        // First premultiplied match state
+        uint32_t _first_match{0};
+        std::vector<uint32_t> _transitions;
+        // Pattern ids of every match state, match state i owns [_match_offsets[i], _match_offsets[i + 1])
+        std::vector<uint32_t> _match_offsets;
+        std::vector<uint32_t> _matches;
+        std::vector<size_t> _lengths;
+    };
+}
+
+#endif //KKI_UTIL_MULTI_SEARCH_H
@@ -0,0 +1,154 @@
+#ifndef KKI_UTIL_PARALLEL_H
+#define KKI_UTIL_PARALLEL_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "string.h"
+
+namespace kki
+{
+    // Multi-threaded versions of the string scans for very large buffers
+    // The text is split into one chunk per thread and the results are merged in order,
+    // so they are identical to the serial versions for any thread count
+    namespace parallel
+    {
+        // Smaller chunks are not worth starting a thread for
+        static const size_t min_chunk = 1 << 20;
+
+        // threads = 0 uses every hardware thread
+        // Return: number of chunks to split len bytes into
+        inline size_t chunk_count(size_t len, size_t threads){
+            if (threads == 0){
+                threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+            }
+            return std::max<size_t>(std::min(threads, len / min_chunk), 1);
+        }
+
+        // Return: start of chunk i out of chunks in [start, end), chunk chunks is end
+        inline const char* chunk_start(const char* start, const char* end, size_t i, size_t chunks){
+            return start + static_cast<size_t>(end - start) * i / chunks;
+        }
+
+        // Calls task(i) for every i in [0, tasks) on its own thread, task 0 runs on the calling thread
+        template<typename T_task>
+        void run(size_t tasks, const T_task& task){
+            std::vector<std::thread> workers;
+            workers.reserve(tasks - 1);
+            for (size_t i = 1; i < tasks; ++i){
+                workers.emplace_back([&task, i](){
+                    task(i);
+                });
+            }
+            task(0);
+            for (auto& worker : workers){
+                worker.join();
+            }
+        }
+
+        // ===== //
+        // Count //
+        // ===== //
+
+        inline size_t count(const char* start, const char* end, char element, size_t threads = 0){
+            assert(start <= end);
+            const size_t chunks = chunk_count(end - start, threads);
+            std::vector<size_t> counts(chunks);
+            run(chunks, [&](size_t i){
+                counts[i] = simd::count(chunk_start(start, end, i, chunks), chunk_start(start, end, i + 1, chunks), element);
+            });
+            size_t total = 0;
+            for (size_t c : counts){
+                total += c;
+            }
+            return total;
+        }
+        inline size_t count(const string& str, char element, size_t threads = 0){
+            return count(str.begin(), str.end(), element, threads);
+        }
+
+        // ======== //
+        // Find all //
+        // ======== //
+
+        // Positions of all the occurrences of element in [start, end) relative to start
+        // Every chunk is counted first, so every thread writes its positions straight into the result
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> find_all(const char* start, const char* end, char element, size_t threads = 0){
+            assert(start <= end);
+            const size_t chunks = chunk_count(end - start, threads);
+            if (chunks == 1){
+                return string::find_all_ptr<T_alloc>(start, start, end, element, 0);
+            }
+
+            std::vector<size_t> offsets(chunks + 1, 0);
+            run(chunks, [&](size_t i){
+                offsets[i + 1] = simd::count(chunk_start(start, end, i, chunks), chunk_start(start, end, i + 1, chunks), element);
+            });
+            for (size_t i = 0; i < chunks; ++i){
+                offsets[i + 1] += offsets[i];
+            }
+
+            std::vector<size_t, T_alloc> res(offsets[chunks]);
+            run(chunks, [&](size_t i){
+                simd::positions(chunk_start(start, end, i, chunks), chunk_start(start, end, i + 1, chunks),
+                                element, start, res.data() + offsets[i], res.data() + offsets[i + 1]);
+            });
+            return res;
+        }
+
+        // Positions of all the occurrences the finder finds in [start, end) relative to start, overlapping ones included
+        // Every chunk searches len - 1 bytes into the next one, so the needles crossing a chunk boundary are found
+        template<typename T_alloc=std::allocator<size_t>, typename T_finder>
+        std::vector<size_t, T_alloc> find_all_finder(const char* start, const char* end, const T_finder& finder, size_t threads = 0){
+            assert(start <= end);
+            const size_t chunks = chunk_count(end - start, threads);
+            if (chunks == 1 || finder.size() == 0){
+                return string::find_all_ptr<T_alloc>(start, start, end, finder, 0);
+            }
+
+            std::vector<std::vector<size_t>> parts(chunks);
+            run(chunks, [&](size_t i){
+                const char* chunk_begin = chunk_start(start, end, i, chunks);
+                const char* chunk_end = chunk_start(start, end, i + 1, chunks);
+                const char* search_end = std::min<const char*>(chunk_end + finder.size() - 1, end);
+                const char* current = finder.find(chunk_begin, search_end);
+                while (current < chunk_end){
+                    parts[i].push_back(current - start);
+                    current = finder.find(current + 1, search_end);
+                }
+            });
+            std::vector<size_t> offsets(chunks + 1, 0);
+            for (size_t i = 0; i < chunks; ++i){
+                offsets[i + 1] = offsets[i] + parts[i].size();
+            }
+
+            std::vector<size_t, T_alloc> res(offsets[chunks]);
+            run(chunks, [&](size_t i){
+                std::copy(parts[i].begin(), parts[i].end(), res.begin() + offsets[i]);
+            });
+            return res;
+        }
+
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> find_all(const string& str, char element, size_t threads = 0){
+            return find_all<T_alloc>(str.begin(), str.end(), element, threads);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> find_all(const string& str, const char* element, size_t threads = 0){
+            return find_all_finder<T_alloc>(str.begin(), str.end(), search::substring(element, strlen(element)), threads);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> find_all(const string& str, const string& element, size_t threads = 0){
+            return find_all_finder<T_alloc>(str.begin(), str.end(), search::substring(element.begin(), element.size()), threads);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> find_all(const string& str, const searcher& element, size_t threads = 0){
+            return find_all_finder<T_alloc>(str.begin(), str.end(), element, threads);
+        }
+    }
+}
+
+#endif //KKI_UTIL_PARALLEL_H
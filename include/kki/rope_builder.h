@@ -0,0 +1,262 @@
+#ifndef KKI_UTIL_ROPE_BUILDER_H
+#define KKI_UTIL_ROPE_BUILDER_H
+
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+#include "buffer.h"
+#include "string.h"
+
+#if defined(KKI_MMAP)
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace kki
+{
+    // Builder for very large outputs, the text is a list of pieces pointing into append only chunks
+    // Appending never moves what was written before, long strings are shared instead of copied,
+    // inserting and erasing only edit the list of pieces
+    // The text is gathered once by to_string or written piece by piece with write
+    class rope_builder{
+    public:
+        static const size_t default_chunk_size = 1 << 16;
+        // Strings at least this long are shared instead of copied
+        static const size_t share_threshold = 1 << 10;
+
+        struct piece{
+            const char* data;
+            size_t size;
+        };
+
+        explicit rope_builder(size_t chunk_size = default_chunk_size) : _chunk_size(std::max<size_t>(chunk_size, 1)){}
+
+        // =============== //
+        // Basic functions //
+        // =============== //
+
+        inline size_t size() const{
+            return _size;
+        }
+        inline const std::vector<piece>& pieces() const{
+            return _pieces;
+        }
+        void clear(){
+            _pieces.clear();
+            _chunks.clear();
+            _shared.clear();
+            _size = 0;
+        }
+
+        // ====== //
+        // Append //
+        // ====== //
+
+        // Fills the free space of the last chunk before starting a new one
+        rope_builder& append(const char* data, size_t len){
+            while (len != 0){
+                if (_chunks.empty() || _chunks.back().size() == _chunks.back().capacity()){
+                    _chunks.emplace_back(std::max(_chunk_size, len));
+                }
+                buffer& chunk = _chunks.back();
+                const size_t n = std::min(len, chunk.capacity() - chunk.size());
+                const char* p = chunk.end();
+                chunk.append(data, n);
+                add_piece(p, n);
+                data += n;
+                len -= n;
+            }
+            return *this;
+        }
+        rope_builder& append(const string& str){
+            if (str.size() < share_threshold){
+                return append(str.data(), str.size());
+            }
+            if (_shared.empty() || _shared.back().data() != str.container.data()){
+                _shared.push_back(str.container);
+            }
+            add_piece(str.data(), str.size());
+            return *this;
+        }
+
+        rope_builder& operator<<(const char* c){
+            return append(c, string::length(c));
+        }
+        rope_builder& operator<<(const string& str){
+            return append(str);
+        }
+        rope_builder& operator<<(const string_builder& builder){
+            return append(builder.data(), builder.size());
+        }
+        rope_builder& operator<<(char c){
+            return append(&c, 1);
+        }
+        // Numbers are formatted like string_builder does
+        template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+        rope_builder& operator<<(T value){
+            _format.clear();
+            _format << value;
+            return append(_format.data(), _format.size());
+        }
+
+        // ======= //
+        // Editing //
+        // ======= //
+
+        // The chars are stored in the chunks and get a piece of their own before pos
+        rope_builder& insert(size_t pos, const char* data, size_t len){
+            assert(pos <= _size);
+            if (len == 0){
+                return *this;
+            }
+            if (pos == _size){
+                return append(data, len);
+            }
+            if (_chunks.empty() || _chunks.back().capacity() - _chunks.back().size() < len){
+                _chunks.emplace_back(std::max(_chunk_size, len));
+            }
+            buffer& chunk = _chunks.back();
+            const piece inserted{chunk.end(), len};
+            chunk.append(data, len);
+
+            const size_t i = split(pos);
+            _pieces.insert(_pieces.begin() + i, inserted);
+            _size += len;
+            return *this;
+        }
+        rope_builder& insert(size_t pos, const string& str){
+            return insert(pos, str.data(), str.size());
+        }
+        rope_builder& insert(size_t pos, const char* cstr){
+            return insert(pos, cstr, string::length(cstr));
+        }
+
+        // Removes [pos, pos + len), the chars stay in their chunks
+        rope_builder& erase(size_t pos, size_t len){
+            assert(pos + len <= _size);
+            if (len == 0){
+                return *this;
+            }
+            const size_t first = split(pos);
+            const size_t last = split(pos + len);
+            _pieces.erase(_pieces.begin() + first, _pieces.begin() + last);
+            _size -= len;
+            return *this;
+        }
+
+        // ====== //
+        // Output //
+        // ====== //
+
+        // Gathers the pieces into one string
+        string to_string() const{
+            buffer data(_size + 1);
+            for (const piece& p : _pieces){
+                data.append(p.data, p.size);
+            }
+            data.push_back('\0');
+            return string(data, data.data(), data.data() + _size);
+        }
+        operator string() const{
+            return to_string();
+        }
+
+        void write(std::ostream& stream) const{
+            for (const piece& p : _pieces){
+                stream.write(p.data, static_cast<std::streamsize>(p.size));
+            }
+        }
+#if defined(KKI_MMAP)
+        // Writes the pieces with as few writev calls as possible
+        // Return: false if a write failed, errno tells why
+        bool write(int fd) const{
+            std::vector<iovec> vectors;
+            vectors.reserve(std::min<size_t>(_pieces.size(), IOV_MAX));
+            size_t i = 0;
+            while (i < _pieces.size()){
+                vectors.clear();
+                for (; i < _pieces.size() && vectors.size() < IOV_MAX; ++i){
+                    vectors.push_back({const_cast<char*>(_pieces[i].data), _pieces[i].size});
+                }
+                if (!write_all(fd, vectors.data(), vectors.size())){
+                    return false;
+                }
+            }
+            return true;
+        }
+#endif
+
+    private:
+        // Extends the last piece if the chars follow it
+        void add_piece(const char* data, size_t len){
+            if (!_pieces.empty() && _pieces.back().data + _pieces.back().size == data){
+                _pieces.back().size += len;
+            }
+            else{
+                _pieces.push_back({data, len});
+            }
+            _size += len;
+        }
+
+        // Splits the piece holding pos so a piece starts at pos
+        // Return: index of the piece starting at pos, the number of pieces if pos is the end
+        size_t split(size_t pos){
+            size_t offset = 0;
+            for (size_t i = 0; i < _pieces.size(); ++i){
+                const piece p = _pieces[i];
+                if (pos == offset){
+                    return i;
+                }
+                if (pos < offset + p.size){
+                    const size_t head = pos - offset;
+                    _pieces[i].size = head;
+                    _pieces.insert(_pieces.begin() + i + 1, piece{p.data + head, p.size - head});
+                    return i + 1;
+                }
+                offset += p.size;
+            }
+            return _pieces.size();
+        }
+
+#if defined(KKI_MMAP)
+        // Retries after partial writes and interrupts
+        static bool write_all(int fd, iovec* vectors, size_t count){
+            while (count != 0){
+                const ssize_t written = writev(fd, vectors, static_cast<int>(count));
+                if (written < 0){
+                    if (errno == EINTR){
+                        continue;
+                    }
+                    return false;
+                }
+                size_t left = static_cast<size_t>(written);
+                while (count != 0 && left >= vectors->iov_len){
+                    left -= vectors->iov_len;
+                    ++vectors;
+                    --count;
+                }
+                if (count != 0){
+                    vectors->iov_base = static_cast<char*>(vectors->iov_base) + left;
+                    vectors->iov_len -= left;
+                }
+            }
+            return true;
+        }
+#endif
+
+        size_t _chunk_size;
+        size_t _size{0};
+        std::vector<piece> _pieces;
+        // Chunks never grow past their capacity, so the pieces stay valid
+        std::vector<buffer> _chunks;
+        // Buffers of the shared strings
+        std::vector<buffer> _shared;
+        string_builder _format;
+    };
+}
+
+#endif //KKI_UTIL_ROPE_BUILDER_H
@@ -0,0 +1,765 @@
+#ifndef KKI_UTIL_SEARCH_H
+#define KKI_UTIL_SEARCH_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "simd.h"
+
+namespace kki
+{
+    namespace search
+    {
+        // Needles up to this length are searched with Horspool, longer ones with Two-Way
+        static const size_t horspool_max_length = 256;
+
+        // ==================== //
+        // Boyer-Moore-Horspool //
+        // ==================== //
+
+        // Horspool over hashed bigrams instead of single chars
+        // Gives long shifts even on small alphabets, the shifts are stored in bytes so needles are limited to horspool_max_length
+        class horspool{
+        public:
+            horspool() = default;
+            horspool(const char* needle, size_t len){
+                assert(len >= 2 && len <= horspool_max_length);
+                auto n = reinterpret_cast<const unsigned char*>(needle);
+                const size_t last = len - 1;
+                // Distance from the last occurrence of each bigram to the end of the needle
+                std::fill_n(_shift, 256, static_cast<uint8_t>(last));
+                for (size_t i = 1; i < last; ++i){
+                    _shift[hash(n + i)] = static_cast<uint8_t>(last - i);
+                }
+                // After a failed verification move to the previous occurrence of the last bigram
+                _mismatch_shift = _shift[hash(n + last)];
+                _shift[hash(n + last)] = 0;
+            }
+
+            // Searches for the needle starting from current
+            // Return: true if the search is finished, current is set to the match or to end if there is none
+            //         false if the verifications got too frequent for the distance covered, current is set to where the search stopped
+            bool find(const char*& current, const char* end, const char* needle, size_t len) const{
+                if (static_cast<size_t>(end - current) < len){
+                    current = end;
+                    return true;
+                }
+                auto h = reinterpret_cast<const unsigned char*>(current);
+                const auto origin = h;
+                const auto last_window = reinterpret_cast<const unsigned char*>(end) - len;
+                const size_t last = len - 1;
+                size_t verifications = 0;
+
+                while (h <= last_window){
+                    size_t shift = _shift[hash(h + last)];
+                    if (shift != 0){
+                        h += shift;
+                        continue;
+                    }
+                    if (memcmp(h, needle, last) == 0){
+                        current = reinterpret_cast<const char*>(h);
+                        return true;
+                    }
+                    h += _mismatch_shift;
+                    if (++verifications * 8 > static_cast<size_t>(h - origin) + 1024){
+                        current = reinterpret_cast<const char*>(h);
+                        return false;
+                    }
+                }
+                current = end;
+                return true;
+            }
+
+        private:
+            // Hash of the bigram ending at p
+            static inline size_t hash(const unsigned char* p){
+                return (static_cast<size_t>(p[0]) - (static_cast<size_t>(p[-1]) << 3)) & 0xff;
+            }
+
+            uint8_t _shift[256];
+            uint8_t _mismatch_shift{0};
+        };
+
+        // ======= //
+        // Two-Way //
+        // ======= //
+
+        // Crochemore-Perrin Two-Way search combined with a bad character shift
+        // Guaranteed O(n + m) time and O(1) extra space regardless of how repetitive the needle is
+        class two_way{
+        public:
+            two_way() = default;
+            two_way(const char* needle, size_t len){
+                assert(len > 0);
+                auto n = reinterpret_cast<const unsigned char*>(needle);
+                _suffix = critical_factorization(n, len, _period);
+                // The needle is periodic if the left half is a repetition of the period
+                _periodic = memcmp(n, n + _period, _suffix) == 0;
+                if (!_periodic){
+                    // Halves are distinct, any mismatch in the left half allows a maximal shift
+                    _period = std::max(_suffix, len - _suffix) + 1;
+                }
+
+                // Distance from the last occurrence of a char to the end of the needle, 0 for the last char
+                std::fill_n(_shift, 256, len);
+                for (size_t i = 0; i < len; ++i){
+                    _shift[n[i]] = len - 1 - i;
+                }
+            }
+
+            const char* find(const char* start, const char* end, const char* needle, size_t len) const{
+                if (static_cast<size_t>(end - start) < len){
+                    return end;
+                }
+                auto h = reinterpret_cast<const unsigned char*>(start);
+                auto n = reinterpret_cast<const unsigned char*>(needle);
+                const size_t available = (end - start) - len;
+                size_t i, j = 0;
+
+                if (_periodic){
+                    // Remember how much of the right half is already known to match
+                    // so repetitions of the period are not rescanned
+                    size_t memory = 0;
+                    while (j <= available){
+                        size_t shift = _shift[h[j + len - 1]];
+                        if (shift != 0){
+                            if (memory != 0 && shift < _period){
+                                shift = len - _period;
+                            }
+                            memory = 0;
+                            j += shift;
+                            continue;
+                        }
+                        // Scan the right half
+                        i = std::max(_suffix, memory);
+                        while (i < len - 1 && n[i] == h[i + j]){
+                            ++i;
+                        }
+                        if (i >= len - 1){
+                            // Scan the left half
+                            i = _suffix - 1;
+                            while (memory < i + 1 && n[i] == h[i + j]){
+                                --i;
+                            }
+                            if (i + 1 < memory + 1){
+                                return start + j;
+                            }
+                            j += _period;
+                            memory = len - _period;
+                        }
+                        else{
+                            j += i - _suffix + 1;
+                            memory = 0;
+                        }
+                    }
+                }
+                else{
+                    while (j <= available){
+                        size_t shift = _shift[h[j + len - 1]];
+                        if (shift != 0){
+                            j += shift;
+                            continue;
+                        }
+                        // Scan the right half
+                        i = _suffix;
+                        while (i < len - 1 && n[i] == h[i + j]){
+                            ++i;
+                        }
+                        if (i >= len - 1){
+                            // Scan the left half
+                            i = _suffix - 1;
+                            while (i != static_cast<size_t>(-1) && n[i] == h[i + j]){
+                                --i;
+                            }
+                            if (i == static_cast<size_t>(-1)){
+                                return start + j;
+                            }
+                            j += _period;
+                        }
+                        else{
+                            j += i - _suffix + 1;
+                        }
+                    }
+                }
+                return end;
+            }
+
+        private:
+            // Computes the critical factorization of the needle from the maximal suffixes
+            // under both the normal and the reversed alphabet ordering
+            // Return: position of the critical factorization, the local period is written to period
+            static size_t critical_factorization(const unsigned char* needle, size_t len, size_t& period){
+                size_t suffix = maximal_suffix(needle, len, false, period);
+                size_t reversed_period;
+                size_t reversed_suffix = maximal_suffix(needle, len, true, reversed_period);
+                if (reversed_suffix + 1 < suffix + 1){
+                    return suffix + 1;
+                }
+                period = reversed_period;
+                return reversed_suffix + 1;
+            }
+
+            // Return: start of the maximal suffix - 1 (wraps to npos for the whole needle)
+            static size_t maximal_suffix(const unsigned char* needle, size_t len, bool reversed, size_t& period){
+                size_t max_suffix = static_cast<size_t>(-1);
+                size_t j = 0, k = 1, p = 1;
+                while (j + k < len){
+                    unsigned char a = needle[j + k];
+                    unsigned char b = needle[max_suffix + k];
+                    if (reversed ? b < a : a < b){
+                        // Suffix is smaller, period is the entire prefix so far
+                        j += k;
+                        k = 1;
+                        p = j - max_suffix;
+                    }
+                    else if (a == b){
+                        // Advance through the repetition of the current period
+                        if (k != p){
+                            ++k;
+                        }
+                        else{
+                            j += p;
+                            k = 1;
+                        }
+                    }
+                    else{
+                        // Suffix is larger, start over from the current location
+                        max_suffix = j++;
+                        k = p = 1;
+                    }
+                }
+                period = p;
+                return max_suffix;
+            }
+
+            size_t _suffix{0};
+            size_t _period{0};
+            bool _periodic{false};
+            size_t _shift[256];
+        };
+
+        // ========= //
+        // Substring //
+        // ========= //
+
+        // Preprocessed needle, the search algorithm is picked by the needle length:
+        //  - short needles filter positions on their first and last char and verify, falling back to Horspool when there are too many false starts
+        //  - needles up to horspool_max_length use Horspool, falling back to Two-Way when the verifications get too frequent
+        //  - longer needles use Two-Way
+        // The needle memory is not owned and has to outlive the object
+        // The tables of long needles are allocated once and shared by copies, so short needle finders stay small and cheap to copy
+        class substring{
+        public:
+            // Needles up to this length start with the first char scan
+            static const size_t short_max_length = 16;
+            // A false start is allowed every false_start_distance bytes on average before switching to Horspool
+            static const size_t false_start_distance = 32;
+
+            substring(const char* needle, size_t len) : _needle(needle), _len(len){
+                if (len > horspool_max_length){
+                    _two_way = std::make_shared<const two_way>(needle, len);
+                }
+                else if (len > short_max_length){
+                    _horspool = std::make_shared<const horspool>(needle, len);
+                }
+            }
+            // Shares the preprocessed tables of other, needle has to be a copy of the needle other was built from
+            substring(const substring& other, const char* needle) : substring(other){
+                _needle = needle;
+            }
+
+            inline const char* data() const{
+                return _needle;
+            }
+            inline size_t size() const{
+                return _len;
+            }
+
+            // Return: pointer to the first occurrence of the needle in [start, end), end if there is none
+            const char* find(const char* start, const char* end) const{
+                assert(start <= end);
+                switch (_len) {
+                    case 0:
+                        return start;
+                    case 1:{
+                        if (start == end){
+                            return end;
+                        }
+                        auto res = static_cast<const char*>(memchr(start, _needle[0], end - start));
+                        return res == nullptr ? end : res;
+                    }
+                    default:;
+                }
+                if (static_cast<size_t>(end - start) < _len){
+                    return end;
+                }
+                if (_len > horspool_max_length){
+                    return _two_way->find(start, end, _needle, _len);
+                }
+                return _len <= short_max_length ? find_short(start, end) : find_horspool(start, end, _needle, _len, *_horspool);
+            }
+
+            // One shot search, the tables of long needles are built on the stack instead of being allocated
+            static const char* find(const char* start, const char* end, const char* needle, size_t len){
+                if (len > horspool_max_length){
+                    return two_way(needle, len).find(start, end, needle, len);
+                }
+                if (len > short_max_length){
+                    return find_horspool(start, end, needle, len, horspool(needle, len));
+                }
+                return substring(needle, len).find(start, end);
+            }
+
+        private:
+            // Compares the first and the last char of the needle against a block of positions at once
+            // and verifies only the positions where both match
+            const char* find_short(const char* start, const char* end) const{
+#if defined(KKI_SIMD)
+                const simd::vector first_char = simd::splat(_needle[0]);
+                const simd::vector last_char = simd::splat(_needle[_len - 1]);
+                const char* current = start;
+                size_t false_starts = 0;
+                // Both loads of the block have to be inside the haystack
+                while (static_cast<size_t>(end - current) >= _len - 1 + simd::width){
+                    simd::mask candidates = simd::equal(simd::load(current), first_char)
+                                          & simd::equal(simd::load(current + _len - 1), last_char);
+                    while (candidates != 0){
+                        const char* candidate = current + simd::lowest_bit(candidates);
+                        if (memcmp(candidate + 1, _needle + 1, _len - 2) == 0){
+                            return candidate;
+                        }
+                        candidates = simd::clear_lowest_bit(candidates);
+                        ++false_starts;
+                    }
+                    current += simd::width;
+                    // The needle ends are common in the haystack, the skip table does better from here on
+                    if (false_starts * false_start_distance > static_cast<size_t>(current - start) + 256){
+                        return find_horspool(current, end, _needle, _len, horspool(_needle, _len));
+                    }
+                }
+                // Scan the remaining positions
+                return find_short_scalar(current, end);
+#else
+                return find_short_scalar(start, end);
+#endif
+            }
+
+            const char* find_short_scalar(const char* start, const char* end) const{
+                const char first_char = _needle[0];
+                const char last_char = _needle[_len - 1];
+                const char* last = end - _len;
+                const char* current = start;
+                size_t false_starts = 0;
+                while (current <= last){
+                    current = static_cast<const char*>(memchr(current, first_char, last - current + 1));
+                    if (current == nullptr){
+                        return end;
+                    }
+                    if (current[_len - 1] == last_char && memcmp(current + 1, _needle + 1, _len - 2) == 0){
+                        return current;
+                    }
+                    ++current;
+                    // The first char is common in the haystack, the skip table does better from here on
+                    if (++false_starts * false_start_distance > static_cast<size_t>(current - start) + 256){
+                        return find_horspool(current, end, _needle, _len, horspool(_needle, _len));
+                    }
+                }
+                return end;
+            }
+
+            // Short needles only build the table once the first char scan gives up
+            static const char* find_horspool(const char* start, const char* end, const char* needle, size_t len, const horspool& table){
+                const char* current = start;
+                if (table.find(current, end, needle, len)){
+                    return current;
+                }
+                // Repetitive needle and haystack, continue in linear time
+                return two_way(needle, len).find(current, end, needle, len);
+            }
+
+            const char* _needle;
+            size_t _len;
+            // Only the one for the needle length is set
+            std::shared_ptr<const horspool> _horspool;
+            std::shared_ptr<const two_way> _two_way;
+        };
+
+        inline const char* find(const char* start, const char* end, const char* needle, size_t len){
+            return substring::find(start, end, needle, len);
+        }
+
+        // ============== //
+        // Reverse search //
+        // ============== //
+
+        // Horspool moving from the back of the haystack to the front
+        // The shift is taken from the first char of the window, so the table is built from the needle read backwards
+        class reverse_horspool{
+        public:
+            reverse_horspool() = default;
+            reverse_horspool(const char* needle, size_t len){
+                assert(len >= 2);
+                auto n = reinterpret_cast<const unsigned char*>(needle);
+                // Distance from the start of the needle to the first occurrence of each char after it
+                std::fill_n(_shift, 256, len);
+                for (size_t i = len - 1; i > 0; --i){
+                    _shift[n[i]] = i;
+                }
+                // After a failed verification move to the next occurrence of the first char
+                _mismatch_shift = _shift[n[0]];
+                _shift[n[0]] = 0;
+            }
+
+            // Searches for the last needle that ends before current
+            // Return: true if the search is finished, current is set to the match or to nullptr if there is none
+            //         false if the verifications got too frequent for the distance covered,
+            //         the needle is not in [current, end) and current is set to where the search stopped
+            bool rfind(const char* start, const char*& current, const char* needle, size_t len) const{
+                if (static_cast<size_t>(current - start) < len){
+                    current = nullptr;
+                    return true;
+                }
+                auto h = reinterpret_cast<const unsigned char*>(start);
+                // Offset of the window from start, kept as an offset so it never points before start
+                size_t window = static_cast<size_t>(current - start) - len;
+                const size_t origin = window;
+                size_t verifications = 0;
+
+                while (true){
+                    size_t shift = _shift[h[window]];
+                    if (shift == 0){
+                        if (memcmp(h + window + 1, needle + 1, len - 1) == 0){
+                            current = start + window;
+                            return true;
+                        }
+                        shift = _mismatch_shift;
+                        if (++verifications * 8 > origin - window + 1024){
+                            // Windows starting before this one are left
+                            current = start + window + len - 1;
+                            return false;
+                        }
+                    }
+                    if (window < shift){
+                        break;
+                    }
+                    window -= shift;
+                }
+                current = nullptr;
+                return true;
+            }
+
+        private:
+            size_t _shift[256];
+            size_t _mismatch_shift{0};
+        };
+
+        // Finds the last occurrence of a needle, the needle has to outlive the finder
+        // Short needles are filtered by their first and last char a block at a time, longer ones use reverse Horspool
+        class reverse_substring{
+        public:
+            reverse_substring(const char* needle, size_t len) : _needle(needle), _len(len){
+                if (len > substring::short_max_length){
+                    _horspool = reverse_horspool(needle, len);
+                }
+            }
+
+            inline const char* data() const{
+                return _needle;
+            }
+            inline size_t size() const{
+                return _len;
+            }
+
+            // Return: pointer to the last occurrence of the needle in [start, end), nullptr if there is none
+            const char* rfind(const char* start, const char* end) const{
+                assert(start <= end);
+                switch (_len) {
+                    case 0:
+                        return end;
+                    case 1:
+                        return simd::rfind(start, end, _needle[0]);
+                    default:;
+                }
+                if (static_cast<size_t>(end - start) < _len){
+                    return nullptr;
+                }
+                return _len <= substring::short_max_length ? rfind_short(start, end) : rfind_horspool(start, end);
+            }
+
+        private:
+            const char* rfind_short(const char* start, const char* end) const{
+                const char last_char = _needle[_len - 1];
+                // Windows starting in [start, start + windows) are left
+                size_t windows = static_cast<size_t>(end - start) - _len + 1;
+#if defined(KKI_SIMD)
+                const simd::vector first = simd::splat(_needle[0]);
+                const simd::vector last = simd::splat(last_char);
+                for (; windows >= simd::width; windows -= simd::width){
+                    const char* block = start + windows - simd::width;
+                    simd::mask candidates = simd::equal(simd::load(block), first)
+                                          & simd::equal(simd::load(block + _len - 1), last);
+                    while (candidates != 0){
+                        const size_t i = simd::highest_bit(candidates);
+                        if (memcmp(block + i + 1, _needle + 1, _len - 2) == 0){
+                            return block + i;
+                        }
+                        candidates ^= simd::mask(1) << i;
+                    }
+                }
+#endif
+                while (windows != 0){
+                    const char* candidate = simd::rfind(start, start + windows, _needle[0]);
+                    if (candidate == nullptr){
+                        return nullptr;
+                    }
+                    if (candidate[_len - 1] == last_char && memcmp(candidate + 1, _needle + 1, _len - 2) == 0){
+                        return candidate;
+                    }
+                    windows = candidate - start;
+                }
+                return nullptr;
+            }
+
+            const char* rfind_horspool(const char* start, const char* end) const{
+                const char* current = end;
+                if (_horspool.rfind(start, current, _needle, _len)){
+                    return current;
+                }
+                // Repetitive needle and haystack, the last forward match is found in linear time
+                const substring forward(_needle, _len);
+                const char* res = nullptr;
+                for (const char* match = forward.find(start, current); match != current; match = forward.find(match + 1, current)){
+                    res = match;
+                }
+                return res;
+            }
+
+            const char* _needle;
+            size_t _len;
+            reverse_horspool _horspool;
+        };
+
+        // Return: pointer to the last occurrence of the needle in [start, end), nullptr if there is none
+        inline const char* rfind(const char* start, const char* end, const char* needle, size_t len){
+            return reverse_substring(needle, len).rfind(start, end);
+        }
+
+        // ================ //
+        // Case insensitive //
+        // ================ //
+
+        // Finds a needle ignoring ASCII case, the needle has to outlive the finder
+        // Both sides are folded to lower case inside the compares, so nothing is copied
+        class isubstring{
+        public:
+            isubstring(const char* needle, size_t len) : _needle(needle), _len(len){}
+
+            inline const char* data() const{
+                return _needle;
+            }
+            inline size_t size() const{
+                return _len;
+            }
+
+            // Return: pointer to the first occurrence of the needle in [start, end), end if there is none
+            const char* find(const char* start, const char* end) const{
+                assert(start <= end);
+                if (_len == 0){
+                    return start;
+                }
+                if (static_cast<size_t>(end - start) < _len){
+                    return end;
+                }
+                const char first_char = simd::lower(_needle[0]);
+                const char last_char = simd::lower(_needle[_len - 1]);
+                const char* current = start;
+#if defined(KKI_SIMD)
+                // Same first and last char filter as substring, on folded blocks
+                const simd::vector first = simd::splat(first_char);
+                const simd::vector last = simd::splat(last_char);
+                for (; static_cast<size_t>(end - current) >= _len - 1 + simd::width; current += simd::width){
+                    simd::mask candidates = simd::equal(simd::lower(simd::load(current)), first)
+                                          & simd::equal(simd::lower(simd::load(current + _len - 1)), last);
+                    while (candidates != 0){
+                        const char* candidate = current + simd::lowest_bit(candidates);
+                        if (simd::imismatch(candidate, _needle, _len) == _len){
+                            return candidate;
+                        }
+                        candidates = simd::clear_lowest_bit(candidates);
+                    }
+                }
+#endif
+                for (const char* last_window = end - _len; current <= last_window; ++current){
+                    if (simd::lower(*current) == first_char && simd::lower(current[_len - 1]) == last_char
+                        && simd::imismatch(current, _needle, _len) == _len){
+                        return current;
+                    }
+                }
+                return end;
+            }
+
+        private:
+            const char* _needle;
+            size_t _len;
+        };
+
+        // ============= //
+        // Other finders //
+        // ============= //
+
+        // Single char needle with the same interface as substring
+        class byte{
+        public:
+            explicit byte(char element) : _element(element){}
+
+            inline const char* data() const{
+                return &_element;
+            }
+            inline size_t size() const{
+                return 1;
+            }
+
+            const char* find(const char* start, const char* end) const{
+                if (start == end){
+                    return end;
+                }
+                auto res = static_cast<const char*>(memchr(start, _element, end - start));
+                return res == nullptr ? end : res;
+            }
+
+        private:
+            char _element;
+        };
+
+        // Finds the chars that satisfy the predicate
+        template<typename T_pred>
+        class predicate{
+        public:
+            explicit predicate(const T_pred& pred) : _pred(pred){}
+
+            const char* find(const char* start, const char* end) const{
+                return std::find_if(start, end, _pred);
+            }
+
+        private:
+            T_pred _pred;
+        };
+
+        // ===== //
+        // Range //
+        // ===== //
+
+        // Lazy range over the positions of all the occurrences the finder finds in [start, end), relative to base
+        // Nothing is allocated, the next occurrence is only searched for when the iterator is advanced
+        // T_finder can be a reference to a finder that outlives the range, iterators are valid while the range is
+        template<typename T_finder>
+        class match_range{
+            using finder_type = typename std::remove_reference<T_finder>::type;
+        public:
+            class iterator{
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = size_t;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const size_t*;
+                using reference = size_t;
+
+                inline size_t operator*() const{
+                    return _current - _base;
+                }
+                iterator& operator++(){
+                    _current = _finder->find(_current + 1, _end);
+                    return *this;
+                }
+                iterator operator++(int){
+                    iterator res = *this;
+                    ++(*this);
+                    return res;
+                }
+                inline bool operator==(const iterator& other) const{
+                    return _current == other._current;
+                }
+                inline bool operator!=(const iterator& other) const{
+                    return _current != other._current;
+                }
+
+            private:
+                friend match_range;
+                iterator(const finder_type* finder, const char* base, const char* current, const char* end)
+                        : _finder(finder), _base(base), _current(current), _end(end){}
+
+                const finder_type* _finder;
+                const char* _base, *_current, *_end;
+            };
+
+            match_range(T_finder finder, const char* base, const char* start, const char* end)
+                    : _finder(finder), _base(base), _start(start), _end(end){
+                assert(base <= start && start <= end);
+            }
+
+            iterator begin() const{
+                return {&_finder, _base, _finder.find(_start, _end), _end};
+            }
+            iterator end() const{
+                return {&_finder, _base, _end, _end};
+            }
+            bool empty() const{
+                return begin() == end();
+            }
+
+        private:
+            T_finder _finder;
+            const char* _base, *_start, *_end;
+        };
+    }
+
+    // ======== //
+    // Searcher //
+    // ======== //
+
+    // Owns a copy of the needle together with its preprocessed tables
+    // Built once and reused for any number of haystacks, accepted by the find, find_all and split functions
+    class searcher{
+    public:
+        explicit searcher(const char* needle) : searcher(needle, strlen(needle)){}
+        searcher(const char* needle, size_t len) : _needle(needle, needle + len), _substring(_needle.data(), len){}
+        // Any string type with data() and size(), like kki::string or std::string
+        template<typename T_string, typename = decltype(std::declval<const T_string&>().size())>
+        explicit searcher(const T_string& needle) : searcher(needle.data(), needle.size()){}
+
+        searcher(const searcher& other) : _needle(other._needle), _substring(other._substring, _needle.data()){}
+        searcher(searcher&& other) = default;
+        searcher& operator=(const searcher& other){
+            if (this != &other){
+                _needle = other._needle;
+                _substring = search::substring(other._substring, _needle.data());
+            }
+            return *this;
+        }
+        searcher& operator=(searcher&& other) = default;
+
+        inline const char* data() const{
+            return _needle.data();
+        }
+        inline size_t size() const{
+            return _needle.size();
+        }
+
+        // Return: pointer to the first occurrence of the needle in [start, end), end if there is none
+        inline const char* find(const char* start, const char* end) const{
+            return _substring.find(start, end);
+        }
+
+    private:
+        std::vector<char> _needle;
+        search::substring _substring;
+    };
+}
+
+#endif //KKI_UTIL_SEARCH_H
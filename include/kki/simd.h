@@ -0,0 +1,453 @@
+#ifndef KKI_UTIL_SIMD_H
+#define KKI_UTIL_SIMD_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// The widest instruction set enabled by the compiler flags is used (-mavx2 for AVX2, SSE2 is the x86-64 baseline)
+// Define KKI_NO_SIMD to force the scalar fallbacks
+#if !defined(KKI_NO_SIMD) && defined(__AVX2__)
+    #define KKI_SIMD
+    #define KKI_SIMD_AVX2
+    #include <immintrin.h>
+    #define KKI_SIMD_SHUFFLE
+#elif !defined(KKI_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #define KKI_SIMD
+    #define KKI_SIMD_SSE2
+    #include <emmintrin.h>
+    // Byte shuffles need SSSE3 (-mssse3 or newer)
+    #if defined(__SSSE3__)
+        #define KKI_SIMD_SHUFFLE
+        #include <tmmintrin.h>
+    #endif
+#endif
+
+namespace kki
+{
+    namespace simd
+    {
+#if defined(KKI_SIMD_AVX2)
+        using vector = __m256i;
+        using mask = uint32_t;
+        static const size_t width = 32;
+        // Mask with a bit set for every byte
+        static const mask full = 0xffffffff;
+
+        inline vector load(const char* p){
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        }
+        inline vector splat(char c){
+            return _mm256_set1_epi8(c);
+        }
+        inline vector zero(){
+            return _mm256_setzero_si256();
+        }
+        inline void store(char* p, vector v){
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+        }
+        // Return: bit i is set if byte i of a and b are equal
+        inline mask equal(vector a, vector b){
+            return static_cast<mask>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+        }
+        // Return: byte i is 0xff if byte i of a and b are equal, 0 otherwise
+        inline vector equal_bytes(vector a, vector b){
+            return _mm256_cmpeq_epi8(a, b);
+        }
+        inline vector subtract(vector a, vector b){
+            return _mm256_sub_epi8(a, b);
+        }
+        inline vector bit_and(vector a, vector b){
+            return _mm256_and_si256(a, b);
+        }
+        inline vector bit_or(vector a, vector b){
+            return _mm256_or_si256(a, b);
+        }
+        inline vector bit_xor(vector a, vector b){
+            return _mm256_xor_si256(a, b);
+        }
+        // Return: bit i is set if the highest bit of byte i is set
+        inline mask to_mask(vector v){
+            return static_cast<mask>(_mm256_movemask_epi8(v));
+        }
+        // Return: every byte shifted right by 4 bits
+        inline vector high_nibbles(vector v){
+            return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+        }
+        // Return: the 16 byte table repeated over the whole vector
+        inline vector load_table(const uint8_t* table){
+            return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+        }
+        // Return: byte i is table[indices[i] & 0x0f], or 0 if the highest bit of indices[i] is set
+        inline vector shuffle(vector table, vector indices){
+            return _mm256_shuffle_epi8(table, indices);
+        }
+        // Return: every ASCII upper case letter replaced by its lower case letter
+        inline vector lower(vector v){
+            // 'A'..'Z' are moved to the bottom of the signed range so one compare finds them
+            const vector shifted = _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(0x80 - 'A')));
+            const vector upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+            return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+        }
+        // Return: every ASCII lower case letter replaced by its upper case letter
+        inline vector upper(vector v){
+            const vector shifted = _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(0x80 - 'a')));
+            const vector letters = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+            return _mm256_xor_si256(v, _mm256_and_si256(letters, _mm256_set1_epi8(0x20)));
+        }
+        // Return: sum of all the bytes as unsigned values
+        inline size_t sum(vector v){
+            __m256i sums = _mm256_sad_epu8(v, _mm256_setzero_si256());
+            return static_cast<size_t>(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1)
+                                     + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+        }
+#elif defined(KKI_SIMD_SSE2)
+        using vector = __m128i;
+        using mask = uint32_t;
+        static const size_t width = 16;
+        // Mask with a bit set for every byte
+        static const mask full = 0xffff;
+
+        inline vector load(const char* p){
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        }
+        inline vector splat(char c){
+            return _mm_set1_epi8(c);
+        }
+        inline vector zero(){
+            return _mm_setzero_si128();
+        }
+        inline void store(char* p, vector v){
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+        }
+        // Return: bit i is set if byte i of a and b are equal
+        inline mask equal(vector a, vector b){
+            return static_cast<mask>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+        }
+        // Return: byte i is 0xff if byte i of a and b are equal, 0 otherwise
+        inline vector equal_bytes(vector a, vector b){
+            return _mm_cmpeq_epi8(a, b);
+        }
+        inline vector subtract(vector a, vector b){
+            return _mm_sub_epi8(a, b);
+        }
+        inline vector bit_and(vector a, vector b){
+            return _mm_and_si128(a, b);
+        }
+        inline vector bit_or(vector a, vector b){
+            return _mm_or_si128(a, b);
+        }
+        inline vector bit_xor(vector a, vector b){
+            return _mm_xor_si128(a, b);
+        }
+        // Return: bit i is set if the highest bit of byte i is set
+        inline mask to_mask(vector v){
+            return static_cast<mask>(_mm_movemask_epi8(v));
+        }
+        // Return: every byte shifted right by 4 bits
+        inline vector high_nibbles(vector v){
+            return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+        }
+        // Return: the 16 byte table in a vector
+        inline vector load_table(const uint8_t* table){
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+        }
+#if defined(KKI_SIMD_SHUFFLE)
+        // Return: byte i is table[indices[i] & 0x0f], or 0 if the highest bit of indices[i] is set
+        inline vector shuffle(vector table, vector indices){
+            return _mm_shuffle_epi8(table, indices);
+        }
+#endif
+        // Return: every ASCII upper case letter replaced by its lower case letter
+        inline vector lower(vector v){
+            // 'A'..'Z' are moved to the bottom of the signed range so one compare finds them
+            const vector shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - 'A')));
+            const vector upper = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+            return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+        }
+        // Return: every ASCII lower case letter replaced by its upper case letter
+        inline vector upper(vector v){
+            const vector shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - 'a')));
+            const vector letters = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+            return _mm_xor_si128(v, _mm_and_si128(letters, _mm_set1_epi8(0x20)));
+        }
+        // Return: sum of all the bytes as unsigned values
+        inline size_t sum(vector v){
+            __m128i sums = _mm_sad_epu8(v, _mm_setzero_si128());
+            return static_cast<size_t>(_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+        }
+#endif
+
+        // Entries past the last position that flatten and positions may overwrite
+        static const size_t flatten_slack = 4;
+
+        // ========= //
+        // Bit masks //
+        // ========= //
+
+        // Bytes per 64 bit mask
+        static const size_t block = 64;
+
+        // Index of the lowest set bit, m must not be 0
+        inline size_t lowest_bit(uint64_t m){
+            return static_cast<size_t>(__builtin_ctzll(m));
+        }
+        inline uint64_t clear_lowest_bit(uint64_t m){
+            return m & (m - 1);
+        }
+        // Return: bit i is the parity of bits 0 to i of m, so the bits between pairs of set bits are set
+        inline uint64_t prefix_xor(uint64_t m){
+            m ^= m << 1;
+            m ^= m << 2;
+            m ^= m << 4;
+            m ^= m << 8;
+            m ^= m << 16;
+            m ^= m << 32;
+            return m;
+        }
+
+#if defined(KKI_SIMD)
+        // Return: bit i is set if byte i of the 64 bytes at p is equal to c
+        inline uint64_t equal_block(const char* p, vector c){
+            uint64_t res = 0;
+            for (size_t i = 0; i < block / width; ++i){
+                res |= static_cast<uint64_t>(equal(load(p + i * width), c)) << (i * width);
+            }
+            return res;
+        }
+
+        // Index of the lowest set bit, m must not be 0
+        inline size_t lowest_bit(mask m){
+            return static_cast<size_t>(__builtin_ctz(m));
+        }
+        // Index of the highest set bit, m must not be 0
+        inline size_t highest_bit(mask m){
+            return static_cast<size_t>(31 - __builtin_clz(m));
+        }
+        inline mask clear_lowest_bit(mask m){
+            return m & (m - 1);
+        }
+        inline size_t bit_count(uint64_t m){
+#if defined(__POPCNT__)
+            return static_cast<size_t>(__builtin_popcountll(m));
+#else
+            m = m - ((m >> 1) & 0x5555555555555555ull);
+            m = (m & 0x3333333333333333ull) + ((m >> 2) & 0x3333333333333333ull);
+            return static_cast<size_t>((((m + (m >> 4)) & 0x0f0f0f0f0f0f0f0full) * 0x0101010101010101ull) >> 56);
+#endif
+        }
+
+        // Writes offset + index of every set bit to out
+        // The first flatten_slack positions are written without branching on the bit count,
+        // so sparse masks do not pay for a mispredicted branch per bit
+        // Return: end of the written positions
+        template<typename T_out>
+        inline T_out* flatten(uint64_t bits, size_t offset, T_out* out){
+            const size_t total = bit_count(bits);
+            for (size_t i = 0; i < flatten_slack; ++i){
+                // The value written for an empty mask is never used
+                out[i] = static_cast<T_out>(offset + lowest_bit(bits | (bits == 0)));
+                bits = clear_lowest_bit(bits);
+            }
+            for (T_out* current = out + flatten_slack; bits != 0; ++current){
+                *current = static_cast<T_out>(offset + lowest_bit(bits));
+                bits = clear_lowest_bit(bits);
+            }
+            return out + total;
+        }
+#endif
+
+        // ============== //
+        // Byte functions //
+        // ============== //
+
+        // Calls callback(position) for every occurrence of c in [start, end) in order
+        // Every block is compared at once and the positions are taken straight from the bitmask
+        template<typename T_callback>
+        inline void for_each(const char* start, const char* end, char c, const T_callback& callback){
+            const char* current = start;
+#if defined(KKI_SIMD)
+            const vector needle = splat(c);
+            for (; static_cast<size_t>(end - current) >= width; current += width){
+                mask m = equal(load(current), needle);
+                while (m != 0){
+                    callback(current + lowest_bit(m));
+                    m = clear_lowest_bit(m);
+                }
+            }
+            for (; current != end; ++current){
+                if (*current == c){
+                    callback(current);
+                }
+            }
+#else
+            while (current != end){
+                current = static_cast<const char*>(memchr(current, c, end - current));
+                if (current == nullptr){
+                    return;
+                }
+                callback(current++);
+            }
+#endif
+        }
+
+        // Return: last occurrence of c in [start, end), nullptr if there is none
+        inline const char* rfind(const char* start, const char* end, char c){
+            const char* current = end;
+#if defined(KKI_SIMD)
+            const vector needle = splat(c);
+            for (; static_cast<size_t>(current - start) >= width; current -= width){
+                const mask m = equal(load(current - width), needle);
+                if (m != 0){
+                    return current - width + highest_bit(m);
+                }
+            }
+#elif defined(__GLIBC__)
+            if (current != start){
+                return static_cast<const char*>(memrchr(start, c, current - start));
+            }
+#endif
+            while (current != start){
+                if (*--current == c){
+                    return current;
+                }
+            }
+            return nullptr;
+        }
+
+        // Writes the offset from base of every occurrence of c in [start, end) to out
+        // out needs room for flatten_slack entries past the last occurrence
+        // Return: end of the written positions
+        template<typename T_out>
+        inline T_out* positions(const char* start, const char* end, char c, const char* base, T_out* out){
+            const char* current = start;
+#if defined(KKI_SIMD)
+            const vector needle = splat(c);
+            for (; static_cast<size_t>(end - current) >= block; current += block){
+                out = flatten(equal_block(current, needle), current - base, out);
+            }
+#endif
+            for_each(current, end, c, [&out, base](const char* position){
+                *out++ = static_cast<T_out>(position - base);
+            });
+            return out;
+        }
+
+        // Same as positions, but nothing is written at or past out_end
+        // out_end - out has to be the number of occurrences
+        template<typename T_out>
+        inline T_out* positions(const char* start, const char* end, char c, const char* base, T_out* out, T_out* out_end){
+            const char* current = start;
+#if defined(KKI_SIMD)
+            const vector needle = splat(c);
+            // The last few occurrences are written one by one so the slack stays inside the output
+            for (; static_cast<size_t>(end - current) >= block && static_cast<size_t>(out_end - out) >= flatten_slack; current += block){
+                out = flatten(equal_block(current, needle), current - base, out);
+            }
+#else
+            (void)out_end;
+#endif
+            for_each(current, end, c, [&out, base](const char* position){
+                *out++ = static_cast<T_out>(position - base);
+            });
+            return out;
+        }
+
+        // Return: number of occurrences of c in [start, end)
+        inline size_t count(const char* start, const char* end, char c){
+            size_t total = 0;
+            const char* current = start;
+#if defined(KKI_SIMD)
+            // Equal bytes are -1, subtracting them counts per byte lane
+            // The lanes are summed before they can overflow after 255 blocks
+            const vector needle = splat(c);
+            while (static_cast<size_t>(end - current) >= width){
+                size_t blocks = std::min<size_t>((end - current) / width, 255);
+                vector counters = zero();
+                for (size_t i = 0; i < blocks; ++i, current += width){
+                    counters = subtract(counters, equal_bytes(load(current), needle));
+                }
+                total += sum(counters);
+            }
+#endif
+            for (; current != end; ++current){
+                total += *current == c;
+            }
+            return total;
+        }
+
+        // ========== //
+        // ASCII case //
+        // ========== //
+
+        inline char lower(char c){
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+        }
+        inline char upper(char c){
+            return c >= 'a' && c <= 'z' ? static_cast<char>(c - ('a' - 'A')) : c;
+        }
+
+        // Return: index of the first byte of a and b that differs ignoring ASCII case, len if there is none
+        inline size_t imismatch(const char* a, const char* b, size_t len){
+            size_t i = 0;
+#if defined(KKI_SIMD)
+            for (; len - i >= width; i += width){
+                const mask m = equal(lower(load(a + i)), lower(load(b + i)));
+                if (m != full){
+                    return i + lowest_bit(~m & full);
+                }
+            }
+#endif
+            for (; i < len; ++i){
+                if (lower(a[i]) != lower(b[i])){
+                    return i;
+                }
+            }
+            return len;
+        }
+
+        // ========== //
+        // Transforms //
+        // ========== //
+
+        // Every transform writes [first, last) transformed to out, out may be equal to first for an in place transform
+
+        inline void lower(const char* first, const char* last, char* out){
+#if defined(KKI_SIMD)
+            for (; static_cast<size_t>(last - first) >= width; first += width, out += width){
+                store(out, lower(load(first)));
+            }
+#endif
+            for (; first != last; ++first, ++out){
+                *out = lower(*first);
+            }
+        }
+        inline void upper(const char* first, const char* last, char* out){
+#if defined(KKI_SIMD)
+            for (; static_cast<size_t>(last - first) >= width; first += width, out += width){
+                store(out, upper(load(first)));
+            }
+#endif
+            for (; first != last; ++first, ++out){
+                *out = upper(*first);
+            }
+        }
+        // Every from is replaced by to
+        inline void replace(const char* first, const char* last, char* out, char from, char to){
+#if defined(KKI_SIMD)
+            const vector needle = splat(from);
+            // Flips the bits of the matching bytes from from to to
+            const vector flip = splat(static_cast<char>(from ^ to));
+            for (; static_cast<size_t>(last - first) >= width; first += width, out += width){
+                const vector v = load(first);
+                store(out, bit_xor(v, bit_and(equal_bytes(v, needle), flip)));
+            }
+#endif
+            for (; first != last; ++first, ++out){
+                *out = *first == from ? to : *first;
+            }
+        }
+    }
+}
+
+#endif //KKI_UTIL_SIMD_H
@@ -0,0 +1,246 @@
+#ifndef KKI_UTIL_SORT_H
+#define KKI_UTIL_SORT_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "parallel.h"
+#include "string.h"
+
+namespace kki
+{
+    // Multikey quicksort over cached key prefixes
+    // Every string is represented by the next 8 chars from the current depth packed into a big endian number,
+    // so most comparisons are one integer compare without touching the chars
+    // Partitioning is three way, the strings equal to the pivot move on to the next 8 chars together,
+    // so shared prefixes are read once per level instead of once per comparison
+    namespace sorting
+    {
+        // Chars per cached key
+        static const size_t key_size = 8;
+        // Smaller ranges are sorted by comparison
+        static const size_t small_range = 32;
+
+        // The chars are cached next to the key so reloading it does not go through the string
+        struct entry{
+            uint64_t key;
+            const char* data;
+            size_t size;
+            string* str;
+        };
+
+        // Return: key_size chars of [data, data + size) from depth on as a big endian number, padded with zeros
+        inline uint64_t load_key(const char* data, size_t size, size_t depth){
+            unsigned char bytes[key_size] = {};
+            if (size > depth){
+                std::memcpy(bytes, data + depth, std::min(size - depth, key_size));
+            }
+            uint64_t res = 0;
+            for (unsigned char b : bytes){
+                res = (res << 8) | b;
+            }
+            return res;
+        }
+        inline entry make_entry(string& str){
+            return {load_key(str.data(), str.size(), 0), str.data(), str.size(), &str};
+        }
+        // Return: true if the key at depth holds the rest of the string
+        inline bool finished(const entry& e, size_t depth){
+            return e.size <= depth + key_size;
+        }
+        // Order of entries whose strings agree on the first depth chars
+        inline bool less(const entry& a, const entry& b, size_t depth){
+            if (a.key != b.key){
+                return a.key < b.key;
+            }
+            return string::compare(a.data + depth, a.size - depth, b.data + depth, b.size - depth) < 0;
+        }
+
+        // Return: number of chars from depth on that every string in [first, last) shares
+        // Stops reading as soon as the prefix is empty, so ranges without a long shared prefix cost little
+        inline size_t common_prefix(const entry* first, const entry* last, size_t depth){
+            size_t res = first->size - depth;
+            for (const entry* e = first + 1; e != last && res != 0; ++e){
+                const size_t len = std::min(res, e->size - depth);
+                res = std::mismatch(first->data + depth, first->data + depth + len, e->data + depth).first - (first->data + depth);
+            }
+            return res;
+        }
+
+        // Partitions allowed before a range falls back to std::sort, twice the depth of a balanced partitioning
+        inline size_t partition_budget(size_t n){
+            size_t res = 0;
+            for (; n > 1; n >>= 1){
+                res += 2;
+            }
+            return res;
+        }
+
+        inline uint64_t median(uint64_t a, uint64_t b, uint64_t c){
+            if (a < b){
+                return b < c ? b : std::max(a, c);
+            }
+            return a < c ? a : std::max(b, c);
+        }
+
+        // Sorts entries whose strings agree on the first depth chars and whose keys are loaded at depth
+        inline void multikey_sort(entry* first, entry* last, size_t depth, size_t budget){
+            auto compare = [depth](const entry& a, const entry& b){
+                return less(a, b, depth);
+            };
+            while (static_cast<size_t>(last - first) > small_range){
+                if (budget == 0){
+                    std::sort(first, last, compare);
+                    return;
+                }
+                --budget;
+
+                const uint64_t pivot = median(first->key, first[(last - first) / 2].key, last[-1].key);
+                // [first, lower) < pivot, [lower, upper) == pivot, [upper, last) > pivot
+                entry* lower = first;
+                entry* upper = last;
+                entry* i = first;
+                while (i < upper){
+                    if (i->key < pivot){
+                        std::swap(*lower++, *i++);
+                    }
+                    else if (i->key > pivot){
+                        std::swap(*i, *--upper);
+                    }
+                    else{
+                        ++i;
+                    }
+                }
+                multikey_sort(first, lower, depth, budget);
+
+                // Strings ending within the pivot are prefixes of the rest of the equal range, shorter ones first
+                entry* rest = std::partition(lower, upper, [depth](const entry& e){
+                    return finished(e, depth);
+                });
+                std::sort(lower, rest, [](const entry& a, const entry& b){
+                    return a.size < b.size;
+                });
+                if (upper - rest > 1){
+                    // Long shared prefixes, like paths or URLs, are skipped at once instead of one key at a time
+                    const size_t next = depth + key_size + common_prefix(rest, upper, depth + key_size);
+                    for (entry* e = rest; e != upper; ++e){
+                        e->key = load_key(e->data, e->size, next);
+                    }
+                    multikey_sort(rest, upper, next, partition_budget(upper - rest));
+                }
+
+                first = upper;
+            }
+            std::sort(first, last, compare);
+        }
+
+        // Return: entries for [first, last) with their first keys
+        inline std::vector<entry> make_entries(string* first, string* last){
+            std::vector<entry> res(last - first);
+            for (size_t i = 0; i < res.size(); ++i){
+                res[i] = make_entry(first[i]);
+            }
+            return res;
+        }
+    }
+
+    // Sorts the strings in lexicographic order of their unsigned chars, a prefix orders before the longer string
+    // The strings are moved into place once at the end
+    inline void sort_strings(string* first, string* last){
+        assert(first <= last);
+        std::vector<sorting::entry> entries = sorting::make_entries(first, last);
+        sorting::multikey_sort(entries.data(), entries.data() + entries.size(), 0, sorting::partition_budget(entries.size()));
+
+        std::vector<string> sorted;
+        sorted.reserve(entries.size());
+        for (const auto& e : entries){
+            sorted.push_back(std::move(*e.str));
+        }
+        std::move(sorted.begin(), sorted.end(), first);
+    }
+    inline void sort_strings(std::vector<string>& strings){
+        sort_strings(strings.data(), strings.data() + strings.size());
+    }
+
+    namespace parallel
+    {
+        // Fewer strings per thread are sorted on one thread
+        static const size_t min_sort = 1 << 16;
+
+        // sort_strings on several threads, the result is the same as the serial one
+        // The strings are distributed into one range per thread by splitters taken from a sample of their first keys,
+        // then every thread sorts its range and moves its strings into place
+        // Strings sharing their first 8 chars always land in the same range, so inputs with few distinct prefixes use fewer threads
+        inline void sort_strings(string* first, string* last, size_t threads = 0){
+            assert(first <= last);
+            if (threads == 0){
+                threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+            }
+            const size_t n = last - first;
+            const size_t ranges = std::max<size_t>(std::min(threads, n / min_sort), 1);
+            if (ranges == 1){
+                kki::sort_strings(first, last);
+                return;
+            }
+
+            std::vector<sorting::entry> entries(n);
+            run(ranges, [&](size_t i){
+                for (size_t j = n * i / ranges; j < n * (i + 1) / ranges; ++j){
+                    entries[j] = sorting::make_entry(first[j]);
+                }
+            });
+
+            // Evenly spaced sample, its quantiles split the keys into ranges of about the same size
+            const size_t oversampling = 64;
+            std::vector<uint64_t> sample(ranges * oversampling);
+            for (size_t i = 0; i < sample.size(); ++i){
+                sample[i] = entries[n * i / sample.size()].key;
+            }
+            std::sort(sample.begin(), sample.end());
+            std::vector<uint64_t> splitters(ranges - 1);
+            for (size_t i = 0; i < splitters.size(); ++i){
+                splitters[i] = sample[(i + 1) * oversampling];
+            }
+
+            // Range i holds the keys in [splitters[i - 1], splitters[i])
+            std::vector<uint32_t> range_of(n);
+            std::vector<size_t> offsets(ranges + 1, 0);
+            for (size_t j = 0; j < n; ++j){
+                range_of[j] = static_cast<uint32_t>(std::upper_bound(splitters.begin(), splitters.end(), entries[j].key) - splitters.begin());
+                ++offsets[range_of[j] + 1];
+            }
+            for (size_t i = 0; i < ranges; ++i){
+                offsets[i + 1] += offsets[i];
+            }
+            std::vector<sorting::entry> distributed(n);
+            {
+                std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+                for (size_t j = 0; j < n; ++j){
+                    distributed[next[range_of[j]]++] = entries[j];
+                }
+            }
+
+            std::vector<string> sorted(n);
+            run(ranges, [&](size_t i){
+                sorting::entry* range_first = distributed.data() + offsets[i];
+                sorting::entry* range_last = distributed.data() + offsets[i + 1];
+                sorting::multikey_sort(range_first, range_last, 0, sorting::partition_budget(range_last - range_first));
+                for (sorting::entry* e = range_first; e != range_last; ++e){
+                    sorted[e - distributed.data()] = std::move(*e->str);
+                }
+            });
+            run(ranges, [&](size_t i){
+                std::move(sorted.begin() + n * i / ranges, sorted.begin() + n * (i + 1) / ranges, first + n * i / ranges);
+            });
+        }
+        inline void sort_strings(std::vector<string>& strings, size_t threads = 0){
+            sort_strings(strings.data(), strings.data() + strings.size(), threads);
+        }
+    }
+}
+
+#endif //KKI_UTIL_SORT_H
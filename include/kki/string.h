@@ -14,10 +14,24 @@
 #include <ostream>
 #include <functional>
 #include "util.h"
+#include "arena.h"
+#include "buffer.h"
+#include "hash.h"
+#include "simd.h"
+#include "transform.h"
+#include "search.h"
+#include "char_set.h"
 
 namespace kki
 {
     class string_builder;
+    template<typename T_finder>
+    class split_range;
+    class line_reader;
+    class csv_reader;
+    class rope_builder;
+    template<typename T_mutex>
+    class basic_string_pool;
 
     class string{
     public:
@@ -28,6 +42,8 @@ namespace kki
 
         using iterator = const char *;
         static const size_t npos = -1;
+        // Strings up to this length are stored inside the string object without a heap allocation
+        static const size_t small_capacity = 23;
 
         // ============ //
         // Constructors //
@@ -36,13 +52,52 @@ namespace kki
         string() : string(""){}
         string(const char *cstr) : string(length(cstr), cstr){}
         string(size_t len, const char *data) {
-            container = make_ref<std::vector<char>>();
-            container->reserve(len + 1);
-            std::copy(data, data + len, std::back_inserter(*container));
-            container->emplace_back('\0');
+            if (len <= small_capacity){
+                set_small(data, len);
+                return;
+            }
+            container = buffer(data, len, len + 1);
+            container.push_back('\0');
 
-            _begin  = container->data();
-            _end    = container->data() + len;
+            _begin  = container.data();
+            _end    = container.data() + len;
+        }
+        // Long strings are copied into the arena, they must not outlive its reset
+        string(size_t len, const char *data, string_arena& arena){
+            if (len <= small_capacity){
+                set_small(data, len);
+                return;
+            }
+            container = buffer(data, len, len + 1, arena);
+            container.push_back('\0');
+
+            _begin  = container.data();
+            _end    = container.data() + len;
+        }
+        // Small strings copy their bytes, long strings share the container
+        string(const string& other) : container(other.container){
+            take_range(other);
+        }
+        string(string&& other) noexcept{
+            // The range is taken first, the container decides if other is small
+            take_range(other);
+            container = std::move(other.container);
+            other.set_small("", 0);
+        }
+        string& operator=(const string& other){
+            if (this != &other){
+                container = other.container;
+                take_range(other);
+            }
+            return *this;
+        }
+        string& operator=(string&& other) noexcept{
+            if (this != &other){
+                take_range(other);
+                container = std::move(other.container);
+                other.set_small("", 0);
+            }
+            return *this;
         }
         // Format consructor
         template<typename ...T_args>
@@ -64,38 +119,54 @@ namespace kki
         inline size_t size() const{
             return _end - _begin;
         }
+        // Return: true if the string is stored inside the object
+        inline bool is_small() const{
+            return !container;
+        }
 
-        void set_data(const ref<std::vector<char>>& data){
+        void set_data(const buffer& data){
             container = data;
-            _begin = container->data();
-            _end = _begin + container->size();
+            _begin = container.data();
+            _end = _begin + container.size();
+        }
+
+        // String over the whole file, substr, split, find and the trims share the mapping instead of copying
+        // Return: empty string if the file cannot be mapped
+        static string map_file(const char* path, access_hint hint = access_hint::normal){
+            string res;
+            const buffer data = buffer::map_file(path, hint);
+            if (data){
+                res.set_data(data);
+            }
+            return res;
+        }
+        static string map_file(const string& path, access_hint hint = access_hint::normal){
+            return map_file(string(path).cstr(), hint);
         }
 
         // ==== //
         // Hash //
         // ==== //
 
+        // Usable in constant expressions, e.g. as case labels of a switch over hash(str.cstr())
+        // Equal to hash(data, length(data)), but reads the chars one at a time
         constexpr static size_t hash(const char* data){
-            const size_t p = 131, m = 4294967291; // 2^32 - 5, largest 32 bit prime
-            size_t total = 0, current_multiplier = 1;
-
-            for (size_t i = 0; data[i] != '\0'; ++i){
-                total = (total + current_multiplier * data[i]) % m;
-                current_multiplier = (current_multiplier * p) % m;
-            }
-            return total;
+            return hashing::hash(data);
         }
+        // Reads the chars a word at a time, see hashing::hash
         static size_t hash(const char* data, size_t len){
-            const size_t p = 131, m = 4294967291; // 2^32 - 5, largest 32 bit prime
-            size_t total = 0, current_multiplier = 1;
-
-            for (size_t i = 0; i < len; ++i){
-                total = (total + current_multiplier * data[i]) % m;
-                current_multiplier = (current_multiplier * p) % m;
-            }
-            return total;
+            return hashing::hash(data, len);
         }
+        // Strings spanning their whole buffer keep the hash in the buffer header
         size_t hash() const{
+            if (spans_container()){
+                size_t res = container.cached_hash();
+                if (res == 0){
+                    res = hash(begin(), size());
+                    container.cache_hash(res);
+                }
+                return res;
+            }
             return hash(begin(), size());
         }
 
@@ -128,31 +199,31 @@ namespace kki
         }
 
         inline bool operator <(const char* other) const {
-            return compare(data(), other, std::min(size(), length(other))) < 0;
+            return compare(data(), size(), other, length(other)) < 0;
         }
         inline bool operator <(const string& other) const {
-            return compare(data(), other.data(), std::min(size(), other.size())) < 0;
+            return compare(data(), size(), other.data(), other.size()) < 0;
         }
 
         inline bool operator <=(const char* other) const {
-            return compare(data(), other, std::min(size(), length(other))) <= 0;
+            return compare(data(), size(), other, length(other)) <= 0;
         }
         inline bool operator <=(const string& other) const {
-            return compare(data(), other.data(), std::min(size(), other.size())) <= 0;
+            return compare(data(), size(), other.data(), other.size()) <= 0;
         }
 
         inline bool operator >(const char* other) const {
-            return compare(data(), other, std::min(size(), length(other))) > 0;
+            return compare(data(), size(), other, length(other)) > 0;
         }
         inline bool operator >(const string& other) const {
-            return compare(data(), other.data(), std::min(size(), other.size())) > 0;
+            return compare(data(), size(), other.data(), other.size()) > 0;
         }
 
         inline bool operator >=(const char* other) const {
-            return compare(data(), other, std::min(size(), length(other))) >= 0;
+            return compare(data(), size(), other, length(other)) >= 0;
         }
         inline bool operator >=(const string& other) const {
-            return compare(data(), other.data(), std::min(size(), other.size())) >= 0;
+            return compare(data(), size(), other.data(), other.size()) >= 0;
         }
 
         // ======== //
@@ -161,6 +232,16 @@ namespace kki
 
         template<typename T_add>
         string_builder operator+(T_add other);
+        // Appends in place when nothing else shares the buffer
+        void operator+=(const string& other){
+            append(other.data(), other.size());
+        }
+        void operator+=(const char* other){
+            append(other, length(other));
+        }
+        void operator+=(char other){
+            append(&other, 1);
+        }
         template<typename T_add>
         void operator+=(const T_add& other);
 
@@ -175,8 +256,6 @@ namespace kki
         // Search //
         // ====== //
 
-        // TODO: Add Boyer-Moore search
-
         // Find
         size_t find(char element, size_t start = 0) const{
             assert(begin() + start <= end());
@@ -193,6 +272,11 @@ namespace kki
             const char* pos = find_ptr(begin() + start, end(), element, len);
             return pos == end() ? npos : pos - begin();
         }
+        size_t find(const searcher& element, size_t start = 0) const{
+            assert(begin() + start <= end());
+            const char* pos = element.find(begin() + start, end());
+            return pos == end() ? npos : pos - begin();
+        }
 
         // Find if
         template<typename T_pred>
@@ -208,35 +292,38 @@ namespace kki
         // Find all instances
         template<typename T_alloc=std::allocator<size_t>>
         std::vector<size_t, T_alloc> find_all(char element, size_t start = 0, size_t elements = 0) const{
-            std::vector<size_t, T_alloc> res;
-            res.reserve(elements);
-            size_t current_pos = find(element, start);
-            while (current_pos != npos){
-                res.push_back(current_pos);
-                current_pos = find(element, current_pos + 1);
-            }
-            res.shrink_to_fit();
-            return res;
+            assert(begin() + start <= end());
+            return find_all_ptr<T_alloc>(begin(), begin() + start, end(), element, elements);
         }
         template<typename T_alloc=std::allocator<size_t>>
         std::vector<size_t, T_alloc> find_all(const string& element, size_t start = 0, size_t elements = 0) const{
-            return find_all(element.begin(), element.size(), start, elements);
+            return find_all<T_alloc>(element.begin(), element.size(), start, elements);
         }
         template<typename T_alloc=std::allocator<size_t>>
         std::vector<size_t, T_alloc> find_all(const char* element, size_t start = 0, size_t elements = 0) const{
-            return find_all(element, length(element), start, elements);
+            return find_all<T_alloc>(element, length(element), start, elements);
         }
         template<typename T_alloc=std::allocator<size_t>>
         std::vector<size_t, T_alloc> find_all(const char* element, size_t len, size_t start, size_t elements) const{
-            std::vector<size_t, T_alloc> res;
-            res.reserve(elements);
-            size_t current_pos = find(element, len, start);
-            while (current_pos != npos){
-                res.push_back(current_pos);
-                current_pos = find(element, len, current_pos + 1);
-            }
-            res.shrink_to_fit();
-            return res;
+            // Preprocess the needle once for all the searches
+            return find_all_ptr<T_alloc>(begin(), begin() + start, end(), search::substring(element, len), elements);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> find_all(const searcher& element, size_t start = 0, size_t elements = 0) const{
+            return find_all_ptr<T_alloc>(begin(), begin() + start, end(), element, elements);
+        }
+        // Positions allocated from the arena
+        arena_vector<size_t> find_all(char element, string_arena& arena, size_t start = 0) const{
+            assert(begin() + start <= end());
+            return find_all_ptr<arena_allocator<size_t>>(begin(), begin() + start, end(), element, 0, arena);
+        }
+        arena_vector<size_t> find_all(const char* element, string_arena& arena, size_t start = 0) const{
+            assert(begin() + start <= end());
+            return find_all_ptr<arena_allocator<size_t>>(begin(), begin() + start, end(), search::substring(element, length(element)), 0, arena);
+        }
+        arena_vector<size_t> find_all(const string& element, string_arena& arena, size_t start = 0) const{
+            assert(begin() + start <= end());
+            return find_all_ptr<arena_allocator<size_t>>(begin(), begin() + start, end(), search::substring(element.begin(), element.size()), 0, arena);
         }
 
         // Find all instances conditional
@@ -253,33 +340,132 @@ namespace kki
             return res;
         }
 
+        // Count instances
+        size_t count(char element, size_t start = 0) const{
+            assert(begin() + start <= end());
+            return count(begin() + start, end(), element);
+        }
+
+        // Find any char of a set
+        size_t find_first_of(const char_set& set, size_t start = 0) const{
+            assert(begin() + start <= end());
+            const char* pos = set.find(begin() + start, end());
+            return pos == end() ? npos : pos - begin();
+        }
+        size_t find_first_not_of(const char_set& set, size_t start = 0) const{
+            assert(begin() + start <= end());
+            const char* pos = set.find_not(begin() + start, end());
+            return pos == end() ? npos : pos - begin();
+        }
+        // Searches [0, last)
+        size_t find_last_of(const char_set& set, size_t last = npos) const{
+            const char* pos = set.find_last(begin(), begin() + std::min(last, size()));
+            return pos == nullptr ? npos : pos - begin();
+        }
+        size_t find_last_not_of(const char_set& set, size_t last = npos) const{
+            const char* pos = set.find_last_not(begin(), begin() + std::min(last, size()));
+            return pos == nullptr ? npos : pos - begin();
+        }
+
+        // Find from the back, searches [0, last)
+        size_t rfind(char element, size_t last = npos) const{
+            const char* pos = simd::rfind(begin(), begin() + std::min(last, size()), element);
+            return pos == nullptr ? npos : pos - begin();
+        }
+        size_t rfind(const char* element, size_t last = npos) const{
+            return rfind(element, length(element), last);
+        }
+        size_t rfind(const string& element, size_t last = npos) const{
+            return rfind(element.begin(), element.size(), last);
+        }
+        size_t rfind(const char* element, size_t len, size_t last) const{
+            // The empty needle is found at the end, even in an empty builder without data
+            if (len == 0){
+                return std::min(last, size());
+            }
+            const char* pos = rfind_ptr(begin(), begin() + std::min(last, size()), element, len);
+            return pos == nullptr ? npos : pos - begin();
+        }
+        template<typename T_pred>
+        size_t rfind_if(const T_pred& predicate, size_t last = npos) const{
+            const char* current = begin() + std::min(last, size());
+            while (current != begin()){
+                if (predicate(*--current)){
+                    return current - begin();
+                }
+            }
+            return npos;
+        }
+
+        // Case insensitive search and comparison, ASCII only
+        size_t ifind(char element, size_t start = 0) const{
+            return ifind(&element, 1, start);
+        }
+        size_t ifind(const char* element, size_t start = 0) const{
+            return ifind(element, length(element), start);
+        }
+        size_t ifind(const string& element, size_t start = 0) const{
+            return ifind(element.begin(), element.size(), start);
+        }
+        size_t ifind(const char* element, size_t len, size_t start) const{
+            assert(data() + start <= end());
+            const char* pos = search::isubstring(element, len).find(begin() + start, end());
+            return pos == end() ? npos : pos - begin();
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> ifind_all(char element, size_t start = 0, size_t elements = 0) const{
+            return ifind_all<T_alloc>(&element, 1, start, elements);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> ifind_all(const char* element, size_t start = 0, size_t elements = 0) const{
+            return ifind_all<T_alloc>(element, length(element), start, elements);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> ifind_all(const string& element, size_t start = 0, size_t elements = 0) const{
+            return ifind_all<T_alloc>(element.begin(), element.size(), start, elements);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> ifind_all(const char* element, size_t len, size_t start, size_t elements) const{
+            return find_all_ptr<T_alloc>(begin(), begin() + start, end(), search::isubstring(element, len), elements);
+        }
+        bool iequals(const char* other) const{
+            return iequal(data(), size(), other, length(other));
+        }
+        bool iequals(const string& other) const{
+            return iequal(data(), size(), other.data(), other.size());
+        }
+        int compare(const char* other) const{
+            return compare(data(), size(), other, length(other));
+        }
+        int compare(const string& other) const{
+            return compare(data(), size(), other.data(), other.size());
+        }
+        int icompare(const char* other) const{
+            return icompare(data(), size(), other, length(other));
+        }
+        int icompare(const string& other) const{
+            return icompare(data(), size(), other.data(), other.size());
+        }
+
         // ==== //
         // Trim //
         // ==== //
 
         // Right trim
         string& r_trim(){
-            while (_end != begin() && isspace(*(_end - 1)))
-                --_end;
+            _end = r_trim_ptr(begin(), end());
             return *this;
         }
         string r_trimmed() const {
-            const char* new_end = data() + size();
-            while (new_end != begin() && isspace(*(new_end - 1)))
-                --new_end;
-            return string(container, begin(), new_end);
+            return string(container, begin(), r_trim_ptr(begin(), end()));
         }
         // Left trim
         string& l_trim(){
-            while (_begin != _end && isspace(*_begin))
-                ++_begin;
+            _begin = char_set::whitespace().find_not(_begin, _end);
             return *this;
         }
         string l_trimmed() const {
-            const char* new_begin = data();
-            while (new_begin != _end && isspace(*new_begin))
-                ++new_begin;
-            return string(container, new_begin, end());
+            return string(container, char_set::whitespace().find_not(begin(), end()), end());
         }
         // Trim both sides
         string& trim(){
@@ -295,24 +481,25 @@ namespace kki
         // Apply //
         // ===== //
 
-        // Converts string using a given predicate
-        string& apply(const std::function<char(char)>& predicate){
-            // Try to detach the string so it is the only string that uses the memory
-            detach();
-            // Fetch variables for iteration
-            char* b = container->data() + (begin() - container->data());
-            char* e = container->data() + (end() - container->data());
-            // Iterate over all data
-            for (char* i = b; i != e; ++i){
-                *i = predicate(*i);
+        // Converts every char with function, a char to char callable or one of the transforms in transform.h
+        // The function is inlined, the transforms in transform.h work a vector at a time
+        template<typename T_function>
+        string& apply(const T_function& function){
+            // Shared chars are transformed straight into a copy, so they are only read once
+            if (!is_small() && !container.unique()){
+                return *this = applied(function);
             }
+            char* b = mutable_begin();
+            transform::apply(function, b, b + size(), b);
             return *this;
         }
 
-        string applied(const std::function<char(char)>& predicate) const {
-            string new_string = clone();
-            new_string.apply(predicate);
-            return new_string;
+        // Copies and transforms in a single pass
+        template<typename T_function>
+        string applied(const T_function& function) const {
+            string res;
+            transform::apply(function, begin(), end(), res.prepare(size()));
+            return res;
         }
 
         // ===== //
@@ -320,37 +507,14 @@ namespace kki
         // ===== //
 
         // Split string with the delimiter being one or more whitespaces
-        template<typename T_alloc=std::allocator<size_t>>
+        template<typename T_alloc=std::allocator<string>>
         std::vector<string, T_alloc> split() const{
-            std::vector<string, T_alloc> res;
-            iterator current = begin();
-            while (true){
-                // Find begin
-                while (current != end() &&  isspace(*current))++current;
-                if(current == end())break;
-                iterator start = current;
-                while (current != end() && !isspace(*current))++current;
-                res.push_back({container, start, current});
-                if(current == end())break;
-            }
-            return res;
+            return split_whitespace(T_alloc());
         }
         // Split string with custom char delimiter
-        template<typename T_alloc=std::allocator<size_t>>
+        template<typename T_alloc=std::allocator<string>>
         std::vector<string, T_alloc> split(char delimiter, size_t splits=0) const{
-            std::vector<string, T_alloc> res;
-            res.reserve(splits);
-            iterator current = begin();
-            if((*current) == delimiter){
-                res.push_back({container, current, current});
-            }
-            while (current < end()){
-                iterator next = find_ptr(current + 1, end(), delimiter);
-                res.push_back({container, current, next});
-                current = next;
-            }
-            res.shrink_to_fit();
-            return res;
+            return split_char(delimiter, splits, T_alloc());
         }
         // Split string with any version of string
         std::vector<string> split(const char* delimiter, size_t splits = 0) const{
@@ -360,23 +524,120 @@ namespace kki
             return split(delimiter.begin(), delimiter.size(), splits);
         }
         std::vector<string> split(const char* delimiter, size_t len, size_t splits) const{
-            std::vector<string> res;
-            res.reserve(splits);
-            iterator current = begin();
-
-            while (current < end()){
-                iterator next = find_ptr(current, end(), delimiter, len);
-                res.push_back({container, current, next});
-                current = next + len;
+            return split_searcher(search::substring(delimiter, len), splits, std::allocator<string>());
+        }
+        // Split string with a preprocessed delimiter
+        std::vector<string> split(const searcher& delimiter, size_t splits = 0) const{
+            return split_searcher(delimiter, splits, std::allocator<string>());
+        }
+        // Same fields as split, written into output instead of a new vector
+        // output is cleared first, so a container reused across calls keeps its capacity
+        // Char delimiters are found a SIMD vector at a time, straight from the comparison bitmask
+        // Return: number of fields
+        template<typename T_container>
+        size_t split_into(T_container& output, char delimiter) const{
+            output.clear();
+            if (size() == 0){
+                return 0;
             }
-
-            if (equal(end() - len, delimiter, len)){
-                res.push_back({container, end(), end()});
+            const char* field = begin();
+            simd::for_each(begin(), end(), delimiter, [&](const char* p){
+                output.push_back(string(container, field, p));
+                field = p + 1;
+            });
+            output.push_back(string(container, field, end()));
+            return output.size();
+        }
+        template<typename T_container>
+        size_t split_into(T_container& output, const char* delimiter) const{
+            return split_into_searcher(output, search::substring(delimiter, length(delimiter)));
+        }
+        template<typename T_container>
+        size_t split_into(T_container& output, const string& delimiter) const{
+            return split_into_searcher(output, search::substring(delimiter.begin(), delimiter.size()));
+        }
+        template<typename T_container>
+        size_t split_into(T_container& output, const searcher& delimiter) const{
+            return split_into_searcher(output, delimiter);
+        }
+
+        // Fields as (begin, end) offsets into this string, nothing is shared so no reference count changes
+        // output holds std::pair<size_t, size_t> or any type constructible from {begin, end}
+        // Return: number of fields
+        template<typename T_container>
+        size_t split_offsets(T_container& output, char delimiter) const{
+            output.clear();
+            if (size() == 0){
+                return 0;
             }
-            res.shrink_to_fit();
-            return res;
+            size_t field = 0;
+            simd::for_each(begin(), end(), delimiter, [&](const char* p){
+                const size_t offset = p - begin();
+                output.push_back({field, offset});
+                field = offset + 1;
+            });
+            output.push_back({field, size()});
+            return output.size();
+        }
+        template<typename T_container>
+        size_t split_offsets(T_container& output, const char* delimiter) const{
+            return split_offsets_searcher(output, search::substring(delimiter, length(delimiter)));
+        }
+        template<typename T_container>
+        size_t split_offsets(T_container& output, const string& delimiter) const{
+            return split_offsets_searcher(output, search::substring(delimiter.begin(), delimiter.size()));
+        }
+        template<typename T_container>
+        size_t split_offsets(T_container& output, const searcher& delimiter) const{
+            return split_offsets_searcher(output, delimiter);
         }
 
+        // The result is allocated from the arena, the fields still share this string's data
+        arena_vector<string> split(string_arena& arena) const{
+            return split_whitespace(arena_allocator<string>(arena));
+        }
+        arena_vector<string> split(char delimiter, string_arena& arena, size_t splits = 0) const{
+            return split_char(delimiter, splits, arena_allocator<string>(arena));
+        }
+        arena_vector<string> split(const char* delimiter, string_arena& arena, size_t splits = 0) const{
+            return split_searcher(search::substring(delimiter, length(delimiter)), splits, arena_allocator<string>(arena));
+        }
+        arena_vector<string> split(const string& delimiter, string_arena& arena, size_t splits = 0) const{
+            return split_searcher(search::substring(delimiter.begin(), delimiter.size()), splits, arena_allocator<string>(arena));
+        }
+
+        // ====== //
+        // Ranges //
+        // ====== //
+
+        // Positions of all the instances, the needle has to outlive the range
+        search::match_range<search::byte> matches(char element, size_t start = 0) const{
+            return {search::byte(element), begin(), begin() + start, end()};
+        }
+        search::match_range<search::substring> matches(const char* element, size_t start = 0) const{
+            return matches(element, length(element), start);
+        }
+        search::match_range<search::substring> matches(const string& element, size_t start = 0) const{
+            return matches(element.begin(), element.size(), start);
+        }
+        search::match_range<search::substring> matches(const char* element, size_t len, size_t start) const{
+            return {search::substring(element, len), begin(), begin() + start, end()};
+        }
+        search::match_range<const searcher&> matches(const searcher& element, size_t start = 0) const{
+            return {element, begin(), begin() + start, end()};
+        }
+        template<typename T_pred>
+        search::match_range<search::predicate<T_pred>> matches_if(const T_pred& pred, size_t start = 0) const{
+            return {search::predicate<T_pred>(pred), begin(), begin() + start, end()};
+        }
+
+        // Fields between delimiters, the delimiter has to outlive the range
+        split_range<search::byte> split_view(char delimiter) const;
+        split_range<search::substring> split_view(const char* delimiter) const;
+        split_range<search::substring> split_view(const string& delimiter) const;
+        split_range<search::substring> split_view(const char* delimiter, size_t len) const;
+        split_range<const searcher&> split_view(const searcher& delimiter) const;
+
         // ========== //
         // Substrings //
         // ========== //
@@ -417,19 +678,23 @@ namespace kki
         // Return: returns true if the string has been detached
         bool detach(){
             // Check if the container is in use by any other string
-            if (container.use_count() != 1){
+            if (!is_small() && !container.unique()){
                 // Get the current size of the string
                 size_t len = size();
+                // Short enough to be stored inline
+                if (len <= small_capacity){
+                    const char* b = begin();
+                    container.reset();
+                    set_small(b, len);
+                    return true;
+                }
                 // Create new container
-                auto res = make_ref<std::vector<char>>();
-
-                res->reserve(len + 1);
-                // Copy contents and zero terminate
-                std::copy(begin(), end(), std::back_inserter(*res));
-                res->push_back('\0');
+                buffer res(begin(), len, len + 1);
+                // Zero terminate
+                res.push_back('\0');
                 // Set member variables
-                container = res;
-                _begin = container->data();
+                container = std::move(res);
+                _begin = container.data();
                 _end = begin() + len;
                 return true;
             }
@@ -438,22 +703,26 @@ namespace kki
 
         // Return: returns true if string is of minimal size
         bool shrink(){
-            std::vector<char>& data = *container;
+            // Inline storage is always minimal
+            if (is_small()){
+                return true;
+            }
+            buffer& data = container;
 
             // Check if the size of the container is minimal
             // -1 because of the zero terminated string
             if ((data.size() - 1) != size()){
                 // Check if it is the only string that uses the container
-                if (container.use_count() == 1){
+                if (container.unique()){
                     size_t len = size();
                     // If the data is not at the start of the container, copy it to the start
                     if (begin() != data.data()){
                         std::copy(begin(), end(), data.begin());
                     }
-                    // Zero terminate the string
-                    data[len] = '\0';
-                    // Shrink the string to the new size
+                    // Shrink the string to the new size, give back the unused capacity and zero terminate it
                     data.resize(len + 1);
+                    data.shrink_to_fit();
+                    data[len] = '\0';
                     // Reset the pointers to the begining and end of string
                     _begin = data.data();
                     _end = _begin + len;
@@ -467,11 +736,21 @@ namespace kki
 
         // Return c style null terminated pointer
         const char* cstr(){
-            std::vector<char>& data = *container;
+            // The inline buffer always has room for the terminator
+            if (is_small()){
+                mutable_begin()[size()] = '\0';
+                return _begin;
+            }
+            buffer& data = container;
+            // Strings reaching the end of the container, as mapped files, have no room for the terminator
+            if (end() == data.end()){
+                *this = clone();
+                return cstr();
+            }
             // If the string is not already null terminated process string
             if ((*end()) != '\0'){
                 // If the string is the only one that uses the container zero terminate it in place
-                if (container.use_count() == 1){
+                if (container.unique()){
                     // Calculate offset from the start of container data to start of string
                     size_t offset = begin() - data.data();
                     // Set the value at the end of the container to \0
@@ -487,10 +766,7 @@ namespace kki
         }
 
         string clone() const {
-            ref<std::vector<char>> new_container = make_ref<std::vector<char>>();
-            new_container->reserve(size());
-            std::copy(begin(), end(), std::back_inserter(*new_container));
-            return {new_container, new_container->data(), new_container->data() + new_container->size()};
+            return string(size(), begin());
         }
 
         // ==== //
@@ -513,63 +789,385 @@ namespace kki
             auto res = static_cast<const char*>(memchr(start, element, end - start));
             return res == nullptr ? end : res;
         }
+        // Horspool for short needles, Two-Way for long ones (see search.h)
         static const char* find_ptr(const char* start, const char* end, const char* element, size_t len){
-            switch (len) {
-                case 0:
-                    return start;
-                case 1:
-                    return find_ptr(start, end, element[0]);
-                default:;
-            }
-
-            const char* current = start;
-            assert(current <= end);
-            const char* last = end - len;
-            while (true){
-                current = find_ptr(current, end, element[0]);
-                if (current > last){
-                    return end;
-                }
-                ++current;
-                if (equal(current, element + 1, len - 1)){
-                    return current - 1;
-                }
-            }
+            assert(start <= end);
+            return search::find(start, end, element, len);
+        }
+        // Return: last occurrence in [start, end), nullptr if there is none
+        static const char* rfind_ptr(const char* start, const char* end, const char* element, size_t len){
+            assert(start <= end);
+            return search::rfind(start, end, element, len);
         }
 
         template<typename T_stream>
         bool getline(T_stream& input_stream){
-            static std::string line;
+            static thread_local std::string line;
             bool res = static_cast<bool>(std::getline(input_stream, line));
-            detach();
-            container->clear();
-            container->reserve(line.length());
-            std::copy(line.begin(), line.end(), std::back_inserter(*container));
-            container->push_back('\0');
-            _begin = container->data();
+            // The container is only reused for long lines when no other string shares it
+            if (line.length() <= small_capacity || is_small() || !container.unique()){
+                *this = string(line.length(), line.data());
+                return res;
+            }
+            container.clear();
+            container.reserve(line.length() + 1);
+            container.append(line.data(), line.length());
+            container.push_back('\0');
+            _begin = container.data();
             _end = _begin + line.length();
             return res;
         }
 
+        static size_t count(const char* start, const char* end, char element){
+            return simd::count(start, end, element);
+        }
+        // Return: end of [start, end) without the trailing whitespace
+        static const char* r_trim_ptr(const char* start, const char* end){
+            const char* last = char_set::whitespace().find_last_not(start, end);
+            return last == nullptr ? start : last + 1;
+        }
+
         static bool equal(const char* i1, const char* i2, size_t len){
             return memcmp(i1, i2, len) == 0;
         }
         static int compare(const char* i1, const char* i2, size_t len){
             return memcmp(i1, i2, len);
         }
+        // Lexicographic order of the unsigned chars, a prefix orders before the longer string
+        static int compare(const char* i1, size_t len1, const char* i2, size_t len2){
+            const int res = memcmp(i1, i2, std::min(len1, len2));
+            if (res != 0){
+                return res;
+            }
+            return len1 < len2 ? -1 : len1 > len2;
+        }
         static inline size_t length(const char* cstr){
             return strlen(cstr);
         }
+        // Equality and order ignoring ASCII case, a prefix orders before the longer string
+        static bool iequal(const char* i1, size_t len1, const char* i2, size_t len2){
+            return len1 == len2 && simd::imismatch(i1, i2, len1) == len1;
+        }
+        static int icompare(const char* i1, size_t len1, const char* i2, size_t len2){
+            const size_t len = std::min(len1, len2);
+            const size_t i = simd::imismatch(i1, i2, len);
+            if (i != len){
+                return static_cast<unsigned char>(simd::lower(i1[i])) < static_cast<unsigned char>(simd::lower(i2[i])) ? -1 : 1;
+            }
+            return len1 < len2 ? -1 : len1 > len2;
+        }
+
+        // Positions of all the occurrences in [start, end) relative to begin
+        // The occurrences are counted first so the result is allocated once with the exact size
+        template<typename T_alloc>
+        static std::vector<size_t, T_alloc> find_all_ptr(const char* begin, const char* start, const char* end, char element, size_t elements,
+                                                         const T_alloc& alloc = T_alloc()){
+            assert(begin <= start && start <= end);
+            std::vector<size_t, T_alloc> res(alloc);
+            size_t total = count(start, end, element);
+            res.reserve(std::max(total + simd::flatten_slack, elements));
+            res.resize(total + simd::flatten_slack);
+            simd::positions(start, end, element, begin, res.data());
+            res.resize(total);
+            return res;
+        }
+        // Positions of all the occurrences in [start, end) relative to begin
+        template<typename T_alloc, typename T_searcher>
+        static std::vector<size_t, T_alloc> find_all_ptr(const char* begin, const char* start, const char* end, const T_searcher& searcher, size_t elements,
+                                                         const T_alloc& alloc = T_alloc()){
+            assert(begin <= start && start <= end);
+            std::vector<size_t, T_alloc> res(alloc);
+            res.reserve(elements);
+            const char* current = searcher.find(start, end);
+            while (current != end){
+                res.push_back(current - begin);
+                current = searcher.find(current + 1, end);
+            }
+            res.shrink_to_fit();
+            return res;
+        }
 
     private:
+        template<typename T_finder>
+        friend class split_range;
+        friend class line_reader;
+        friend class csv_reader;
+        template<typename T_mutex>
+        friend class basic_string_pool;
+        friend class rope_builder;
+        friend class string_builder;
+
+        template<typename T_alloc>
+        std::vector<string, T_alloc> split_whitespace(const T_alloc& alloc) const{
+            constexpr char_set whitespace = char_set::whitespace();
+            std::vector<string, T_alloc> res(alloc);
+            iterator current = begin();
+            while (true){
+                // Find begin
+                current = whitespace.find_not(current, end());
+                if(current == end())break;
+                iterator start = current;
+                current = whitespace.find(current, end());
+                res.push_back({container, start, current});
+                if(current == end())break;
+            }
+            return res;
+        }
+        template<typename T_alloc>
+        std::vector<string, T_alloc> split_char(char delimiter, size_t splits, const T_alloc& alloc) const;
+
+        template<typename T_searcher, typename T_alloc>
+        std::vector<string, T_alloc> split_searcher(const T_searcher& delimiter, size_t splits, const T_alloc& alloc) const{
+            std::vector<string, T_alloc> res(alloc);
+            res.reserve(splits);
+            iterator current = begin();
+            const size_t len = delimiter.size();
+
+            while (current < end()){
+                iterator next = delimiter.find(current, end());
+                res.push_back({container, current, next});
+                current = next + len;
+            }
+
+            // The last delimiter ends exactly at the end of the string
+            if (size() != 0 && current == end()){
+                res.push_back({container, end(), end()});
+            }
+            res.shrink_to_fit();
+            return res;
+        }
+
+        template<typename T_container, typename T_searcher>
+        size_t split_into_searcher(T_container& output, const T_searcher& delimiter) const{
+            output.clear();
+            if (size() == 0){
+                return 0;
+            }
+            const char* field = begin();
+            const char* next = delimiter.find(field, end());
+            while (next != end()){
+                output.push_back(string(container, field, next));
+                field = next + delimiter.size();
+                next = delimiter.find(field, end());
+            }
+            output.push_back(string(container, field, end()));
+            return output.size();
+        }
+        template<typename T_container, typename T_searcher>
+        size_t split_offsets_searcher(T_container& output, const T_searcher& delimiter) const{
+            output.clear();
+            if (size() == 0){
+                return 0;
+            }
+            const char* field = begin();
+            const char* next = delimiter.find(field, end());
+            while (next != end()){
+                output.push_back({static_cast<size_t>(field - begin()), static_cast<size_t>(next - begin())});
+                field = next + delimiter.size();
+                next = delimiter.find(field, end());
+            }
+            output.push_back({static_cast<size_t>(field - begin()), size()});
+            return output.size();
+        }
 
         // Private constructor for member functions
-        string(const ref<std::vector<char>>& data, const char* begin, const char* end) : _begin(begin), _end(end), container(data){}
+        // Slices that fit inline are copied instead of sharing the container
+        string(const buffer& data, const char* begin, const char* end){
+            const size_t len = end - begin;
+            if (len <= small_capacity){
+                set_small(begin, len);
+            }
+            else{
+                container = data;
+                _begin = begin;
+                _end = end;
+            }
+        }
+
+        // Copies len bytes into the inline buffer, container has to be empty
+        void set_small(const char* data, size_t len){
+            assert(len <= small_capacity);
+            std::copy(data, data + len, _small);
+            _small[len] = '\0';
+            _begin = _small;
+            _end = _small + len;
+        }
+        // Makes this string the only user of len uninitialized chars
+        // Return: writable pointer to the first of them
+        char* prepare(size_t len){
+            if (len <= small_capacity){
+                container.reset();
+                _small[len] = '\0';
+                _begin = _small;
+                _end = _small + len;
+                return _small;
+            }
+            container = buffer(len + 1);
+            char* res = container.expand(len + 1);
+            res[len] = '\0';
+            _begin = res;
+            _end = res + len;
+            return res;
+        }
+        // Points this string at the same bytes as other, inline bytes are copied into this string
+        void take_range(const string& other){
+            if (other.is_small()){
+                std::copy(other._small, other._small + small_capacity + 1, _small);
+                _begin = _small + (other._begin - other._small);
+                _end = _small + (other._end - other._small);
+            }
+            else{
+                _begin = other._begin;
+                _end = other._end;
+            }
+        }
+        // Return: writable pointer to the first char, the string has to be detached
+        char* mutable_begin(){
+            if (is_small()){
+                return _small + (_begin - _small);
+            }
+            container.reset_hash();
+            return container.data() + (_begin - container.data());
+        }
+        // Appends in place when this string is the only user of its buffer and ends at the terminator,
+        // the buffer grows geometrically so repeated appends are amortized O(1) per char
+        void append(const char* data, size_t len){
+            const size_t old = size();
+            const bool aliased = !is_small() && !std::less<const char*>()(data, container.data())
+                                 && std::less<const char*>()(data, container.data() + container.capacity());
+            if (!is_small() && !aliased && container.unique() && _end + 1 == container.end() && *_end == '\0'){
+                const size_t offset = _begin - container.data();
+                container.resize(container.size() - 1);
+                container.append(data, len);
+                container.push_back('\0');
+                _begin = container.data() + offset;
+                _end = _begin + old + len;
+                return;
+            }
+            if (old + len <= small_capacity){
+                char joined[small_capacity];
+                std::copy(begin(), end(), joined);
+                std::copy(data, data + len, joined + old);
+                container.reset();
+                set_small(joined, old + len);
+                return;
+            }
+            buffer res(begin(), old, old + len + 1);
+            res.append(data, len);
+            res.push_back('\0');
+            container = std::move(res);
+            _begin = container.data();
+            _end = _begin + old + len;
+        }
+        // Return: true if the string is all of its buffer but the terminator
+        bool spans_container() const{
+            return !is_small() && _begin == container.data() && size() + 1 == container.size();
+        }
+        // Points this string at [begin, end) of data, also if it would fit inline
+        void share(const buffer& data, const char* begin, const char* end){
+            container = data;
+            _begin = begin;
+            _end = end;
+        }
 
         const char* _begin{nullptr}, *_end{nullptr};
-        ref<std::vector<char>> container;
+        buffer container;
+        char _small[small_capacity + 1];
+    };
+
+    // Lazy range over the fields between delimiters, same fields as split but nothing is allocated
+    // The range keeps a reference to the string data, the next field is only searched for when the iterator is advanced
+    template<typename T_finder>
+    class split_range{
+    public:
+        class iterator{
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = string;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const string*;
+            using reference = string;
+
+            string operator*() const{
+                return {_range->_string.container, _field_begin, _field_end};
+            }
+            iterator& operator++(){
+                const char* end = _range->_string.end();
+                if (_field_end == end){
+                    // The last field is not followed by a delimiter
+                    _field_begin = _field_end = nullptr;
+                }
+                else{
+                    _field_begin = _field_end + _range->_finder.size();
+                    _field_end = _range->_finder.find(_field_begin, end);
+                }
+                return *this;
+            }
+            iterator operator++(int){
+                iterator res = *this;
+                ++(*this);
+                return res;
+            }
+            inline bool operator==(const iterator& other) const{
+                return _field_begin == other._field_begin;
+            }
+            inline bool operator!=(const iterator& other) const{
+                return _field_begin != other._field_begin;
+            }
+
+        private:
+            friend split_range;
+            iterator(const split_range* range, const char* field_begin, const char* field_end)
+                    : _range(range), _field_begin(field_begin), _field_end(field_end){}
+
+            const split_range* _range;
+            const char* _field_begin, *_field_end;
+        };
+
+        split_range(const string& str, T_finder delimiter) : _string(str), _finder(delimiter){
+            assert(_finder.size() > 0);
+        }
+
+        iterator begin() const{
+            if (_string.size() == 0){
+                return end();
+            }
+            return {this, _string.begin(), _finder.find(_string.begin(), _string.end())};
+        }
+        iterator end() const{
+            return {this, nullptr, nullptr};
+        }
+
+    private:
+        string _string;
+        T_finder _finder;
     };
 
+    inline split_range<search::byte> string::split_view(char delimiter) const{
+        return {*this, search::byte(delimiter)};
+    }
+    inline split_range<search::substring> string::split_view(const char* delimiter) const{
+        return split_view(delimiter, length(delimiter));
+    }
+    inline split_range<search::substring> string::split_view(const string& delimiter) const{
+        return split_view(delimiter.begin(), delimiter.size());
+    }
+    inline split_range<search::substring> string::split_view(const char* delimiter, size_t len) const{
+        return {*this, search::substring(delimiter, len)};
+    }
+    inline split_range<const searcher&> string::split_view(const searcher& delimiter) const{
+        return {*this, delimiter};
+    }
+
+    template<typename T_alloc>
+    std::vector<string, T_alloc> string::split_char(char delimiter, size_t splits, const T_alloc& alloc) const{
+        std::vector<string, T_alloc> res(alloc);
+        // Counting the delimiters is much cheaper than growing the result
+        res.reserve(std::max(splits, size() != 0 ? count(delimiter) + 1 : 0));
+        split_into(res, delimiter);
+        return res;
+    }
+
     // TODO:
     //      Adding different kinds of containers to print
     class string_builder{
@@ -581,35 +1179,54 @@ namespace kki
         // Constructors //
         // ============ //
 
-        explicit string_builder(size_t size=0) : _data(make_ref<std::vector<char>>()){
-            _data->reserve(size);
+        // Nothing is allocated until something is written
+        explicit string_builder(size_t size=0){
+            if (size != 0){
+                storage(size);
+            }
         }
-        string_builder(char t, size_t size) : _data(make_ref<std::vector<char>>()){
-            _data->reserve(size);
-            std::fill_n(std::back_inserter(*_data), size, t);
+        // The chars are allocated from the arena, also when the builder grows
+        explicit string_builder(string_arena& arena, size_t size=0) : _data(size, arena){}
+        string_builder(char t, size_t size){
+            if (size != 0){
+                storage(size).append(size, t);
+            }
         }
         explicit string_builder(const char* cstr) : string_builder(string::length(cstr), cstr){}
         explicit string_builder(const string& string) : string_builder(string.size(), string.begin()){}
-        string_builder(size_t len, const char* data) : _data(make_ref<std::vector<char>>()){
-            _data->reserve(len);
-            std::copy(data, data + len, std::back_inserter(*_data));
+        string_builder(size_t len, const char* data){
+            append(data, len);
         }
-        explicit string_builder(ref<std::vector<char>>& data_container) : _data(data_container){}
+        // Shares the chars of data_container
+        explicit string_builder(buffer& data_container) : _data(data_container){}
         template<typename ...T_args>
-        explicit string_builder(const char *format, T_args ...args) : _data(make_ref<std::vector<char>>()){
+        explicit string_builder(const char *format, T_args ...args){
             format_recursion(*this, format, args...);
         }
+        // Copies own their chars, only the buffer constructor and set_data_container share them
+        // The size lives in the shared buffer header, so two builders appending to one buffer would overwrite each other
+        string_builder(const string_builder& other) : string_builder(other.size(), other.data()){}
+        // Moved from builders are empty
+        string_builder(string_builder&& other) noexcept = default;
+        string_builder& operator=(const string_builder& other){
+            if (this != &other){
+                _data.reset();
+                append(other.data(), other.size());
+            }
+            return *this;
+        }
+        string_builder& operator=(string_builder&& other) noexcept = default;
 
         // ================== //
         // Data getter/setter //
         // ================== //
 
-        void set_data_container(ref<std::vector<char>>& other){
+        void set_data_container(buffer& other){
             _data = other;
         }
-        ref<std::vector<char>> get_data_container()
+        buffer get_data_container()
         {
-            return _data;
+            return storage(0);
         }
 
         // =============== //
@@ -617,28 +1234,35 @@ namespace kki
         // =============== //
 
         inline size_t size() const{
-            return _data->size();
+            return _data ? _data.size() : 0;
         }
         inline size_t capacity() const{
-            return _data->capacity();
+            return _data ? _data.capacity() : 0;
         }
         inline void reserve(size_t size){
-            _data->reserve(size);
+            storage(size).reserve(size + 1);
+        }
+        // Keeps the capacity
+        inline void clear(){
+            if (_data){
+                _data.clear();
+            }
         }
+        // Return: nullptr for an empty builder that never allocated
         inline char* data(){
-            return _data->data();
+            return _data ? _data.data() : nullptr;
         }
         inline const char* data() const{
-            return _data->data();
+            return _data ? _data.data() : nullptr;
         }
         inline iterator begin() const {
-            return _data->data();
+            return const_cast<char*>(data());
         }
         inline iterator end() const {
-            return _data->data() + _data->size();
+            return begin() + size();
         }
         inline char& back(){
-            return _data->back();
+            return _data.back();
         }
 
         // ============= //
@@ -646,16 +1270,16 @@ namespace kki
         // ============= //
 
         inline char& at(size_t i){
-            assert(i < _data->size());
-            return _data->at(i);
+            assert(i < size());
+            return _data[i];
         }
         inline char  get(size_t i) const{
-            assert(i < _data->size());
-            return _data->at(i);
+            assert(i < size());
+            return _data[i];
         }
         inline void  set(size_t i, char elem){
-            assert(i < _data->size());
-            _data->at(i) = elem;
+            assert(i < size());
+            _data[i] = elem;
         }
 
         inline char& operator[](size_t i){
@@ -670,11 +1294,9 @@ namespace kki
         // ==================== //
 
         string_builder& append(const char* c, size_t len){
-            // So it doesnt reserve for too small strings
-            if(len > _data->capacity()){
-                _data->reserve(_data->capacity() + len);
+            if (len != 0){
+                storage(len).append(c, len);
             }
-            std::copy(c, c+len, std::back_inserter(*_data));
             return *this;
         }
         template<typename T_pr>
@@ -692,7 +1314,7 @@ namespace kki
             return append(b ? "true" : "false");
         }
         string_builder& operator<<(char c){
-            _data->push_back(c);
+            storage(1).push_back(c);
             return *this;
         }
         string_builder& operator<<(int i){
@@ -729,16 +1351,21 @@ namespace kki
         }
 
         string_builder operator*(size_t _i){
-            string_builder s(_data->size() * _i);
+            string_builder s(size() * _i);
             for(size_t i = 0; i < _i; ++i){
-                std::copy(_data->begin(), _data->end(), std::back_inserter(*s._data));
+                s.append(data(), size());
             }
             return s;
         }
         string_builder& operator*=(size_t _i){
-            _data->resize(_data->size() * _i);
-            for(size_t i = 0; i < _i - 1; ++i){
-                std::copy(_data->begin(), _data->end(), std::back_inserter(*_data));
+            if (!_data){
+                return *this;
+            }
+            // The first copy is already in place, the others are copied from it
+            const size_t len = _data.size();
+            _data.resize(len * _i);
+            for(size_t i = 1; i < _i; ++i){
+                std::copy(_data.data(), _data.data() + len, _data.data() + len * i);
             }
             return *this;
         }
@@ -746,7 +1373,8 @@ namespace kki
         template<typename T_p>
         string_builder operator+(T_p p){
             string_builder s;
-            return s.append(_data->data(), _data->size()) << append(p);
+            s.append(data(), size()) << append(p);
+            return s;
         }
         template<typename T_p>
         string_builder& operator+=(T_p p){
@@ -757,8 +1385,31 @@ namespace kki
         // Conversion to string //
         // ==================== //
 
-        string to_string(){
-            return string(_data->size(), _data->data());
+        string to_string() const&{
+            return string(size(), data());
+        }
+        // std::move(builder).to_string() hands the chars over like release
+        string to_string() &&{
+            return release();
+        }
+        string to_string(string_arena& arena) const{
+            return string(size(), data(), arena);
+        }
+        // Hands the chars to a string without copying them, the builder is left empty
+        string release(){
+            if (!_data){
+                return string();
+            }
+            // Chars shared through the data container are copied
+            if (!_data.unique()){
+                string res(size(), data());
+                _data.reset();
+                return res;
+            }
+            const size_t len = _data.size();
+            _data.push_back('\0');
+            const buffer released = std::move(_data);
+            return string(released, released.data(), released.data() + len);
         }
         operator string(){
             return to_string();
@@ -772,7 +1423,7 @@ namespace kki
         static string format(const char* format, T_args... args){
             string_builder b;
             format_recursion(b, format, args...);
-            return b.to_string();
+            return b.release();
         }
 
         // ==== //
@@ -795,6 +1446,11 @@ namespace kki
             const char* pos = string::find_ptr(begin() + start, end(), element, len);
             return pos == end() ? npos : pos - begin();
         }
+        size_t find(const searcher& element, size_t start = 0) const{
+            assert(data() + start <= end());
+            const char* pos = element.find(begin() + start, end());
+            return pos == end() ? npos : pos - begin();
+        }
 
         // Find if
         template<typename T_pred>
@@ -810,15 +1466,8 @@ namespace kki
         // Find all instances
         template<typename T_alloc=std::allocator<size_t>>
         std::vector<size_t, T_alloc> find_all(char element, size_t start = 0, size_t elements = 0) const{
-            std::vector<size_t, T_alloc> res;
-            res.reserve(elements);
-            size_t current_pos = find(element, start);
-            while (current_pos != npos){
-                res.push_back(current_pos);
-                current_pos = find(element, current_pos + 1);
-            }
-            res.shrink_to_fit();
-            return res;
+            assert(data() + start <= end());
+            return string::find_all_ptr<T_alloc>(begin(), begin() + start, end(), element, elements);
         }
         template<typename T_alloc=std::allocator<size_t>>
         std::vector<size_t, T_alloc> find_all(const string& element, size_t start = 0, size_t elements = 0) const{
@@ -830,15 +1479,12 @@ namespace kki
         }
         template<typename T_alloc=std::allocator<size_t>>
         std::vector<size_t, T_alloc> find_all(const char* element, size_t len, size_t start, size_t elements) const{
-            std::vector<size_t, T_alloc> res;
-            res.reserve(elements);
-            size_t current_pos = find(element, len, start);
-            while (current_pos != npos){
-                res.push_back(current_pos);
-                current_pos = find(element, len, current_pos + 1);
-            }
-            res.shrink_to_fit();
-            return res;
+            // Preprocess the needle once for all the searches
+            return string::find_all_ptr<T_alloc>(begin(), begin() + start, end(), search::substring(element, len), elements);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> find_all(const searcher& element, size_t start = 0, size_t elements = 0) const{
+            return string::find_all_ptr<T_alloc>(begin(), begin() + start, end(), element, elements);
         }
 
         // Find all instances conditional
@@ -855,6 +1501,129 @@ namespace kki
             return res;
         }
 
+        // Count instances
+        size_t count(char element, size_t start = 0) const{
+            assert(data() + start <= end());
+            return string::count(begin() + start, end(), element);
+        }
+
+        // Find any char of a set
+        size_t find_first_of(const char_set& set, size_t start = 0) const{
+            assert(data() + start <= end());
+            const char* pos = set.find(begin() + start, end());
+            return pos == end() ? npos : pos - begin();
+        }
+        size_t find_first_not_of(const char_set& set, size_t start = 0) const{
+            assert(data() + start <= end());
+            const char* pos = set.find_not(begin() + start, end());
+            return pos == end() ? npos : pos - begin();
+        }
+        // Searches [0, last)
+        size_t find_last_of(const char_set& set, size_t last = npos) const{
+            const char* pos = set.find_last(begin(), begin() + std::min(last, size()));
+            return pos == nullptr ? npos : pos - begin();
+        }
+        size_t find_last_not_of(const char_set& set, size_t last = npos) const{
+            const char* pos = set.find_last_not(begin(), begin() + std::min(last, size()));
+            return pos == nullptr ? npos : pos - begin();
+        }
+
+        // Find from the back, searches [0, last)
+        size_t rfind(char element, size_t last = npos) const{
+            const char* pos = simd::rfind(begin(), begin() + std::min(last, size()), element);
+            return pos == nullptr ? npos : pos - begin();
+        }
+        size_t rfind(const char* element, size_t last = npos) const{
+            return rfind(element, string::length(element), last);
+        }
+        size_t rfind(const string& element, size_t last = npos) const{
+            return rfind(element.begin(), element.size(), last);
+        }
+        size_t rfind(const char* element, size_t len, size_t last) const{
+            // The empty needle is found at the end, even in an empty builder without data
+            if (len == 0){
+                return std::min(last, size());
+            }
+            const char* pos = string::rfind_ptr(begin(), begin() + std::min(last, size()), element, len);
+            return pos == nullptr ? npos : pos - begin();
+        }
+        template<typename T_pred>
+        size_t rfind_if(const T_pred& predicate, size_t last = npos) const{
+            const char* current = begin() + std::min(last, size());
+            while (current != begin()){
+                if (predicate(*--current)){
+                    return current - begin();
+                }
+            }
+            return npos;
+        }
+
+        // Case insensitive search and comparison, ASCII only
+        size_t ifind(char element, size_t start = 0) const{
+            return ifind(&element, 1, start);
+        }
+        size_t ifind(const char* element, size_t start = 0) const{
+            return ifind(element, string::length(element), start);
+        }
+        size_t ifind(const string& element, size_t start = 0) const{
+            return ifind(element.begin(), element.size(), start);
+        }
+        size_t ifind(const char* element, size_t len, size_t start) const{
+            assert(data() + start <= end());
+            const char* pos = search::isubstring(element, len).find(begin() + start, end());
+            return pos == end() ? npos : pos - begin();
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> ifind_all(char element, size_t start = 0, size_t elements = 0) const{
+            return ifind_all<T_alloc>(&element, 1, start, elements);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> ifind_all(const char* element, size_t start = 0, size_t elements = 0) const{
+            return ifind_all<T_alloc>(element, string::length(element), start, elements);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> ifind_all(const string& element, size_t start = 0, size_t elements = 0) const{
+            return ifind_all<T_alloc>(element.begin(), element.size(), start, elements);
+        }
+        template<typename T_alloc=std::allocator<size_t>>
+        std::vector<size_t, T_alloc> ifind_all(const char* element, size_t len, size_t start, size_t elements) const{
+            return string::find_all_ptr<T_alloc>(begin(), begin() + start, end(), search::isubstring(element, len), elements);
+        }
+        bool iequals(const char* other) const{
+            return string::iequal(data(), size(), other, string::length(other));
+        }
+        bool iequals(const string& other) const{
+            return string::iequal(data(), size(), other.data(), other.size());
+        }
+        int icompare(const char* other) const{
+            return string::icompare(data(), size(), other, string::length(other));
+        }
+        int icompare(const string& other) const{
+            return string::icompare(data(), size(), other.data(), other.size());
+        }
+
+        // Positions of all the instances, the needle has to outlive the range
+        // The range is invalidated by any change to the builder
+        search::match_range<search::byte> matches(char element, size_t start = 0) const{
+            return {search::byte(element), begin(), begin() + start, end()};
+        }
+        search::match_range<search::substring> matches(const char* element, size_t start = 0) const{
+            return matches(element, string::length(element), start);
+        }
+        search::match_range<search::substring> matches(const string& element, size_t start = 0) const{
+            return matches(element.begin(), element.size(), start);
+        }
+        search::match_range<search::substring> matches(const char* element, size_t len, size_t start) const{
+            return {search::substring(element, len), begin(), begin() + start, end()};
+        }
+        search::match_range<const searcher&> matches(const searcher& element, size_t start = 0) const{
+            return {element, begin(), begin() + start, end()};
+        }
+        template<typename T_pred>
+        search::match_range<search::predicate<T_pred>> matches_if(const T_pred& pred, size_t start = 0) const{
+            return {search::predicate<T_pred>(pred), begin(), begin() + start, end()};
+        }
+
         struct view{
         public:
             char& at(size_t i){
@@ -882,12 +1651,12 @@ namespace kki
                 if(len < size()){
                     // Replacement string is shorter than the view
                     std::copy(other.begin(), other.end(), begin());
-                    _parent._data->erase(_parent._data->begin() + _begin + len, _parent._data->begin() + _end);
+                    _parent._data.erase(_begin + len, _end);
                 }
                 else if(len >= size()) {
                     // Replacement string is longer than the view
                     std::copy(other.begin(), other.begin() + size(), begin());
-                    _parent._data->insert(_parent._data->begin() + _begin + size(), other.begin() + size(), other.end());
+                    _parent.storage(len - size()).insert(_begin + size(), other.begin() + size(), other.end());
                 }
                 else{
                     // Replacement string is of equal size
@@ -902,7 +1671,7 @@ namespace kki
             friend string_builder;
             view(string_builder& parent, size_t begin, size_t end) : _parent{parent}, _begin{begin}, _end{end}{
                 assert(begin <= end);
-                assert(end <= parent._data->size());
+                assert(end <= parent.size());
             }
 
             string_builder& _parent;
@@ -938,31 +1707,38 @@ namespace kki
             }
         }
 
+        // Released and moved from builders have no buffer until something is written
+        // One more char is allocated so release can add the terminator in place
+        buffer& storage(size_t capacity){
+            if (!_data){
+                _data = buffer(capacity + 1);
+            }
+            return _data;
+        }
+
         char buf[128]{};
-        ref<std::vector<char>> _data;
+        buffer _data;
     };
 
     // Formatted string constructor
     template<typename... T_args>
     string::string(const char *format, T_args... args) {
-        string s = string_builder::format(format, args...);
-        this->container = s.container;
-        this->_begin = s.begin();
-        this->_end = s.end();
+        *this = string_builder::format(format, args...);
     }
 
     template<typename T_add>
     string_builder string::operator+(T_add other) {
         string_builder s(*this);
-        return s << other;
+        s << other;
+        return s;
     }
 
     template<typename T_add>
     void string::operator+=(const T_add& other) {
-        string_builder sb(*this);
+        // Numbers and the like are formatted by a builder first
+        string_builder sb;
         sb << other;
-        string new_str = sb.to_string();
-        this->container = new_str.container;
+        append(sb.data(), sb.size());
     }
 
     string_builder string::operator*(size_t _i) {
@@ -978,22 +1754,21 @@ namespace kki
         for (size_t i = 0; i < _i; ++i){
             sb << (*this);
         }
-        string new_str = sb.to_string();
-        this->container = new_str.container;
+        *this = std::move(sb).to_string();
     }
 
     // Util
 
     template<typename T_stream>
     static string getline(T_stream& input_stream){
-        static std::string line;
+        static thread_local std::string line;
         std::getline(input_stream, line);
         return string(line.size(), line.data());
     }
 
     template<typename T_stream>
     static bool getline(T_stream& input_stream, string& str){
-        static std::string line;
+        static thread_local std::string line;
         bool res = static_cast<bool>(std::getline(input_stream, line));
         str = string(line.size(), line.data());
         return res;
@@ -0,0 +1,113 @@
+#ifndef KKI_UTIL_STRING_POOL_H
+#define KKI_UTIL_STRING_POOL_H
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include "buffer.h"
+#include "string.h"
+
+namespace kki
+{
+    // Lock for pools used by a single thread
+    struct null_mutex{
+        void lock(){}
+        void unlock(){}
+    };
+
+    // Deduplicates strings into one canonical copy each
+    // Interned strings share the canonical buffer, also the ones short enough to be stored inline,
+    // so equal interned strings compare by pointer in O(1) and hash from the value cached in the buffer
+    // Canonical copies live as long as the pool or any string interned from it
+    template<typename T_mutex>
+    class basic_string_pool{
+    public:
+        struct statistics{
+            // Distinct strings held by the pool
+            size_t strings{0};
+            // Calls to intern
+            size_t lookups{0};
+            // Chars held by the pool
+            size_t stored_bytes{0};
+            // Chars of interned duplicates that share the canonical copies instead of holding their own
+            size_t saved_bytes{0};
+        };
+
+        basic_string_pool() = default;
+        basic_string_pool(const basic_string_pool&) = delete;
+        basic_string_pool& operator=(const basic_string_pool&) = delete;
+
+        // Return: canonical copy of the chars, added to the pool if it is new
+        string intern(const char* data, size_t len){
+            const size_t hash = string::hash(data, len);
+            std::lock_guard<T_mutex> lock(_mutex);
+            ++_stats.lookups;
+            auto range = _strings.equal_range(hash);
+            for (auto i = range.first; i != range.second; ++i){
+                const string& canonical = i->second;
+                if (canonical.size() == len && string::equal(canonical.data(), data, len)){
+                    if (canonical.data() != data){
+                        _stats.saved_bytes += len;
+                    }
+                    return canonical;
+                }
+            }
+
+            buffer storage(data, len, len + 1);
+            storage.push_back('\0');
+            storage.cache_hash(hash);
+            string canonical;
+            canonical.share(storage, storage.data(), storage.data() + len);
+            _strings.emplace(hash, canonical);
+            ++_stats.strings;
+            _stats.stored_bytes += len;
+            return canonical;
+        }
+        string intern(const char* cstr){
+            return intern(cstr, string::length(cstr));
+        }
+        string intern(const string& str){
+            return intern(str.data(), str.size());
+        }
+
+        // Return: true if str was interned before
+        bool contains(const string& str) const{
+            const size_t hash = str.hash();
+            std::lock_guard<T_mutex> lock(_mutex);
+            auto range = _strings.equal_range(hash);
+            for (auto i = range.first; i != range.second; ++i){
+                if (i->second == str){
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t size() const{
+            std::lock_guard<T_mutex> lock(_mutex);
+            return _strings.size();
+        }
+        statistics stats() const{
+            std::lock_guard<T_mutex> lock(_mutex);
+            return _stats;
+        }
+
+        // Forgets every canonical copy, strings interned before keep theirs alive
+        void clear(){
+            std::lock_guard<T_mutex> lock(_mutex);
+            _strings.clear();
+            _stats = statistics();
+        }
+
+    private:
+        std::unordered_multimap<size_t, string> _strings;
+        statistics _stats;
+        mutable T_mutex _mutex;
+    };
+
+    using string_pool = basic_string_pool<null_mutex>;
+    // Can be shared by threads, every call takes a lock
+    using concurrent_string_pool = basic_string_pool<std::mutex>;
+}
+
+#endif //KKI_UTIL_STRING_POOL_H
@@ -0,0 +1,185 @@
+#ifndef KKI_UTIL_STRING_SWITCH_H
+#define KKI_UTIL_STRING_SWITCH_H
+
+#include <cstdint>
+#include <cstdlib>
+#include "hash.h"
+#include "string.h"
+
+namespace kki
+{
+    // Perfect hash over a fixed list of keys, built at compile time
+    // find returns the dense index of the key in the list, or not_found (equal to size()) for anything else,
+    // so the result can index a table of size() + 1 entries or label the cases of a switch:
+    //
+    //     static constexpr auto days = make_string_switch("monday", "tuesday", "wednesday");
+    //     switch (days.find(str)){
+    //         case days.find("monday"): ...
+    //
+    // Keys are spread over buckets by their hash and every bucket gets a displacement that moves its keys to free slots,
+    // a lookup is one hash, one multiplication and one comparison with the key in the slot
+    // Duplicate keys, or keys the displacements cannot separate, stop a constexpr construction from compiling
+    template<size_t T_count>
+    class string_switch{
+    public:
+        static_assert(T_count != 0, "string_switch needs at least one key");
+        static constexpr size_t not_found = T_count;
+
+        // Keys must outlive the switch, string literals always do
+        template<typename ...T_keys>
+        constexpr explicit string_switch(const T_keys&... keys) : _keys{keys...}{
+            static_assert(sizeof...(T_keys) == T_count, "string_switch<N> takes N keys");
+            size_t hashes[T_count] = {};
+            for (size_t i = 0; i < T_count; ++i){
+                while (_keys[i][_lengths[i]] != '\0'){
+                    ++_lengths[i];
+                }
+                hashes[i] = static_cast<size_t>(hashing::hash<hashing::byte_reader>(_keys[i], _lengths[i], 0));
+            }
+            // Equal hashes would always share a slot, this also catches duplicate keys
+            for (size_t i = 0; i < T_count; ++i){
+                for (size_t j = i + 1; j < T_count; ++j){
+                    if (hashes[i] == hashes[j]){
+                        fail();
+                    }
+                }
+            }
+            for (size_t s = 0; s < table_size; ++s){
+                _slots[s] = not_found;
+            }
+
+            // Largest buckets first, while most slots are still free
+            size_t bucket_sizes[bucket_count] = {};
+            for (size_t i = 0; i < T_count; ++i){
+                ++bucket_sizes[bucket(hashes[i])];
+            }
+            for (size_t size = T_count; size != 0; --size){
+                for (size_t b = 0; b < bucket_count; ++b){
+                    if (bucket_sizes[b] == size){
+                        place(b, hashes);
+                    }
+                }
+            }
+        }
+
+        // Return: index of the key, not_found if it is not one of the keys
+        size_t find(const char* data, size_t len) const{
+            return match(static_cast<size_t>(hashing::hash(data, len)), data, len);
+        }
+        // Uses the hash cached by the string
+        size_t find(const string& str) const{
+            return match(str.hash(), str.data(), str.size());
+        }
+        // Usable in constant expressions, e.g. as case labels
+        constexpr size_t find(const char* cstr) const{
+            size_t len = 0;
+            while (cstr[len] != '\0'){
+                ++len;
+            }
+            const size_t i = _slots[slot(static_cast<size_t>(hashing::hash<hashing::byte_reader>(cstr, len, 0)))];
+            if (i == not_found || _lengths[i] != len){
+                return not_found;
+            }
+            for (size_t c = 0; c < len; ++c){
+                if (_keys[i][c] != cstr[c]){
+                    return not_found;
+                }
+            }
+            return i;
+        }
+
+        constexpr size_t size() const{
+            return T_count;
+        }
+        constexpr const char* key(size_t i) const{
+            return _keys[i];
+        }
+
+    private:
+        static constexpr size_t power_of_two(size_t n){
+            size_t res = 1;
+            while (res < n){
+                res <<= 1;
+            }
+            return res;
+        }
+        // Keys fill at most half of the slots and there are about two keys per bucket
+        static constexpr size_t table_size = power_of_two(2 * T_count);
+        static constexpr size_t bucket_count = power_of_two((T_count + 1) / 2);
+        // Displacements tried per bucket before giving up
+        static constexpr uint32_t max_displacement = 1 << 16;
+
+        static constexpr size_t bucket(size_t hash){
+            return hash & (bucket_count - 1);
+        }
+        // The buckets use the low bits of the hash, the slots a remix of all of them
+        static constexpr size_t slot(size_t hash, uint32_t displacement){
+            return static_cast<size_t>(hashing::mix(hash ^ hashing::secret0, displacement ^ hashing::secret1)) & (table_size - 1);
+        }
+        constexpr size_t slot(size_t hash) const{
+            return slot(hash, _displacements[bucket(hash)]);
+        }
+
+        // Finds the first displacement that puts every key of bucket b into a free slot
+        constexpr void place(size_t b, const size_t (&hashes)[T_count]){
+            for (uint32_t d = 0; d != max_displacement; ++d){
+                bool fits = true;
+                for (size_t i = 0; i < T_count && fits; ++i){
+                    if (bucket(hashes[i]) == b){
+                        const size_t s = slot(hashes[i], d);
+                        if (_slots[s] == not_found){
+                            _slots[s] = i;
+                        }
+                        else{
+                            fits = false;
+                        }
+                    }
+                }
+                if (fits){
+                    _displacements[b] = d;
+                    return;
+                }
+                // Takes back the slots this displacement filled
+                for (size_t i = 0; i < T_count; ++i){
+                    if (bucket(hashes[i]) == b && _slots[slot(hashes[i], d)] == i){
+                        _slots[slot(hashes[i], d)] = not_found;
+                    }
+                }
+            }
+            fail();
+        }
+
+        size_t match(size_t hash, const char* data, size_t len) const{
+            const size_t i = _slots[slot(hash)];
+            return i != not_found && _lengths[i] == len && string::equal(_keys[i], data, len) ? i : not_found;
+        }
+
+        // Not constexpr, so reaching it during constant evaluation is a compile error
+        static void fail(){
+            std::abort();
+        }
+
+        const char* _keys[T_count];
+        size_t _lengths[T_count]{};
+        uint32_t _displacements[bucket_count]{};
+        size_t _slots[table_size]{};
+    };
+
+    // Definitions, so the constants can be bound to references before C++17
+    template<size_t T_count>
+    constexpr size_t string_switch<T_count>::not_found;
+    template<size_t T_count>
+    constexpr size_t string_switch<T_count>::table_size;
+    template<size_t T_count>
+    constexpr size_t string_switch<T_count>::bucket_count;
+    template<size_t T_count>
+    constexpr uint32_t string_switch<T_count>::max_displacement;
+
+    // Return: string_switch over the keys, declare it constexpr to build it at compile time
+    template<typename ...T_keys>
+    constexpr string_switch<sizeof...(T_keys)> make_string_switch(const T_keys&... keys){
+        return string_switch<sizeof...(T_keys)>(keys...);
+    }
+}
+
+#endif //KKI_UTIL_STRING_SWITCH_H
@@ -0,0 +1,112 @@
+#ifndef KKI_UTIL_TRANSFORM_H
+#define KKI_UTIL_TRANSFORM_H
+
+#include <cstdint>
+#include <utility>
+#include "simd.h"
+
+namespace kki
+{
+    // Char transforms for string::apply and string::applied
+    // Besides the char call every transform here has a range call that works a vector at a time
+    namespace transform
+    {
+        // ASCII letters to lower case
+        struct lower{
+            char operator()(char c) const{
+                return simd::lower(c);
+            }
+            void operator()(const char* first, const char* last, char* out) const{
+                simd::lower(first, last, out);
+            }
+        };
+
+        // ASCII letters to upper case
+        struct upper{
+            char operator()(char c) const{
+                return simd::upper(c);
+            }
+            void operator()(const char* first, const char* last, char* out) const{
+                simd::upper(first, last, out);
+            }
+        };
+
+        // Every from to to
+        class replace{
+        public:
+            replace(char from, char to) : _from(from), _to(to){}
+
+            char operator()(char c) const{
+                return c == _from ? _to : c;
+            }
+            void operator()(const char* first, const char* last, char* out) const{
+                simd::replace(first, last, out, _from, _to);
+            }
+
+        private:
+            char _from;
+            char _to;
+        };
+
+        // Any char to char mapping, looked up in a 256 entry table
+        // Building the table from a function turns branches into one load per char,
+        // shuffling 16 entries at a time was measured slower than the plain lookups
+        class table{
+        public:
+            // Maps every char to itself
+            table(){
+                for (size_t i = 0; i < 256; ++i){
+                    _table[i] = static_cast<uint8_t>(i);
+                }
+            }
+            template<typename T_function>
+            explicit table(const T_function& function){
+                for (size_t i = 0; i < 256; ++i){
+                    _table[i] = static_cast<uint8_t>(function(static_cast<char>(i)));
+                }
+            }
+
+            table& set(char from, char to){
+                _table[static_cast<unsigned char>(from)] = static_cast<uint8_t>(to);
+                return *this;
+            }
+
+            char operator()(char c) const{
+                return static_cast<char>(_table[static_cast<unsigned char>(c)]);
+            }
+            void operator()(const char* first, const char* last, char* out) const{
+                for (; first != last; ++first, ++out){
+                    *out = static_cast<char>(_table[static_cast<unsigned char>(*first)]);
+                }
+            }
+
+        private:
+            uint8_t _table[256];
+        };
+
+        // ===== //
+        // Apply //
+        // ===== //
+
+        // Transforms with a range call use it
+        template<typename T_function>
+        inline auto apply(const T_function& function, const char* first, const char* last, char* out, int)
+            -> decltype(function(first, last, out), void()){
+            function(first, last, out);
+        }
+        // Any other function is called for every char, inlined since its type is known
+        template<typename T_function>
+        inline void apply(const T_function& function, const char* first, const char* last, char* out, long){
+            for (; first != last; ++first, ++out){
+                *out = static_cast<char>(function(*first));
+            }
+        }
+        // Writes [first, last) transformed by function to out, out may be equal to first
+        template<typename T_function>
+        inline void apply(const T_function& function, const char* first, const char* last, char* out){
+            apply(function, first, last, out, 0);
+        }
+    }
+}
+
+#endif //KKI_UTIL_TRANSFORM_H
@@ -3,8 +3,32 @@
 #include <chrono>
 #include "include/kki/random.h"
 #include "include/kki/string.h"
+#include "include/kki/multi_search.h"
+#include "include/kki/parallel.h"
+#include "include/kki/line_reader.h"
+#include "include/kki/string_pool.h"
+#include "include/kki/rope_builder.h"
+#include "include/kki/string_switch.h"
+#include "include/kki/sort.h"
+#include "include/kki/csv_reader.h"
+#include <cstdio>
 #include <deque>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
+// Random alphanumeric chars, the same for every call of the same size
+std::vector<char> random_corpus(size_t size){
+    kki::random rand(0);
+    std::vector<char> res;
+    res.reserve(size);
+    for (size_t i = 0; i < size; ++i){
+        res.emplace_back(rand.random_alnum());
+    }
+    return res;
+}
 
 void test_find(const kki::string& s, kki::random& rand, size_t tests){
     size_t l{0};
@@ -42,13 +66,8 @@ void find_substr(std::string& str, std::vector<std::vector<char>>& substrs){
 }
 
 void test_element(){
-    kki::random rand(0);
     const size_t data_size = 10000000;
-    std::vector<char> data;
-    data.reserve(data_size);
-    for(unsigned i = 0; i < data_size; ++i){
-        data.emplace_back(rand.random_alnum());
-    }
+    std::vector<char> data = random_corpus(data_size);
 
     std::string s;
     s.reserve(data_size);
@@ -71,18 +90,14 @@ void test_element(){
 }
 
 void test_substrs(){
-    kki::random rand(0);
     const size_t data_size = 10000000;
-    std::vector<char> data;
-    data.reserve(data_size);
-    for(unsigned i = 0; i < data_size; ++i){
-        data.emplace_back(rand.random_alnum());
-    }
+    std::vector<char> data = random_corpus(data_size);
+    kki::random rand(1);
 
     std::string s;
     s.reserve(data_size);
     std::copy(data.begin(), data.end(), std::back_inserter(s));
-    kki::string str(data.data(), data_size);
+    kki::string str(data_size, data.data());
 
     const size_t test_size = 1000;
     std::vector<std::vector<char>> tests;
@@ -108,15 +123,130 @@ void test_substrs(){
     std::cout << "Find std " << (end2 - begin2).count() << std::endl;
 }
 
-void test_find_all(){
+void test_substrs_repetitive(){
+    // Small alphabet with long needles, most first chars of the needle are false starts
     kki::random rand(0);
+    const char alphabet[] = "ACGT";
     const size_t data_size = 10000000;
     std::vector<char> data;
     data.reserve(data_size);
     for(unsigned i = 0; i < data_size; ++i){
-        data.emplace_back(rand.random_alnum());
+        data.emplace_back(alphabet[rand.random_index(4)]);
+    }
+
+    std::string s(data.begin(), data.end());
+    kki::string str(data_size, data.data());
+
+    const size_t test_size = 100;
+    std::vector<std::vector<char>> tests;
+    tests.reserve(test_size);
+    for(size_t i = 0; i < test_size; ++i){
+        size_t len = rand.random_int(8, 64);
+        std::vector<char> element(len + 1);
+        for(size_t j = 0; j < len; ++j){
+            element[j] = alphabet[rand.random_index(4)];
+        }
+        tests.push_back(element);
+    }
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    find_substr(str, tests);
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    find_substr(s, tests);
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Find     " << (end1 - begin1).count() << std::endl;
+    std::cout << "Find std " << (end2 - begin2).count() << std::endl;
+}
+
+void test_searcher(){
+    // Many short lines searched for the same needles
+    const size_t data_size = 1000000;
+    const size_t line_size = 100;
+    std::vector<char> data = random_corpus(data_size);
+    kki::random rand(1);
+    kki::string str(data_size, data.data());
+
+    std::vector<kki::string> lines;
+    for(size_t i = 0; i < data_size; i += line_size){
+        lines.push_back(str.substr(i, line_size));
+    }
+
+    const size_t test_size = 300;
+    std::vector<std::vector<char>> tests;
+    std::vector<kki::searcher> searchers;
+    for(size_t i = 0; i < test_size; ++i){
+        size_t len = rand.random_int(2,10);
+        std::vector<char> element(len + 1);
+        for(size_t j = 0; j < len; ++j){
+            element[j] = rand.random_alnum();
+        }
+        tests.push_back(element);
+        searchers.emplace_back(element.data());
     }
-    kki::string str(data.data(), data_size);
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    for(auto& line : lines){
+        for(auto& test : tests){
+            total_1 += line.find(test.data());
+        }
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2{0};
+    for(auto& line : lines){
+        for(auto& searcher : searchers){
+            total_2 += line.find(searcher);
+        }
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Find cstr     " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Find searcher " << total_2 << " " << (end2 - begin2).count() << std::endl;
+}
+
+void test_multi_searcher(){
+    const size_t data_size = 10000000;
+    std::vector<char> data = random_corpus(data_size);
+    kki::random rand(1);
+    kki::string str(data_size, data.data());
+
+    const size_t keyword_count = 1000;
+    std::vector<kki::string> keywords;
+    keywords.reserve(keyword_count);
+    for(size_t i = 0; i < keyword_count; ++i){
+        size_t len = rand.random_int(3,8);
+        std::vector<char> element(len);
+        for(size_t j = 0; j < len; ++j){
+            element[j] = rand.random_alnum();
+        }
+        keywords.emplace_back(len, element.data());
+    }
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    for(auto& keyword : keywords){
+        total_1 += str.find_all(keyword).size();
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    kki::multi_searcher searcher(keywords);
+    size_t total_2 = searcher.find_all(str).size();
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Find all      " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Multi search  " << total_2 << " " << (end2 - begin2).count() << std::endl;
+}
+
+void test_find_all(){
+    const size_t data_size = 10000000;
+    std::vector<char> data = random_corpus(data_size);
+    kki::string str(data_size, data.data());
 
     const char test_begin = 'a';
     const char test_end = 'z';
@@ -130,7 +260,880 @@ void test_find_all(){
     }
     auto end1 = std::chrono::high_resolution_clock::now();
 
-    std::cout << "Find     " << (end1 - begin1).count() << std::endl;
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2{0};
+    for ( char i = test_begin; i <= test_end; ++i){
+        total_2 += str.count(i);
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Find     " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Count    " << total_2 << " " << (end2 - begin2).count() << std::endl;
+}
+
+void test_ranges(){
+    const size_t data_size = 10000000;
+    std::vector<char> data = random_corpus(data_size);
+    kki::string str(data_size, data.data());
+
+    // First 10 matches only
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    auto all = str.find_all('a');
+    for (size_t i = 0; i < 10 && i < all.size(); ++i){
+        total_1 += all[i];
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2{0}, found{0};
+    for (size_t pos : str.matches('a')){
+        total_2 += pos;
+        if (++found == 10) break;
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    // Stream through all the fields once
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    size_t total_3{0};
+    for (auto& field : str.split('a')){
+        total_3 += field.size();
+    }
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    auto begin4 = std::chrono::high_resolution_clock::now();
+    size_t total_4{0};
+    for (auto field : str.split_view('a')){
+        total_4 += field.size();
+    }
+    auto end4 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "First 10 find_all " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "First 10 matches  " << total_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Split             " << total_3 << " " << (end3 - begin3).count() << std::endl;
+    std::cout << "Split view        " << total_4 << " " << (end4 - begin4).count() << std::endl;
+}
+
+void test_char_set(){
+    const size_t data_size = 10000000;
+    std::vector<char> data = random_corpus(data_size);
+    // Rare delimiters so most of the time goes into scanning
+    for (size_t i = 0; i < data_size; i += 97){
+        data[i] = ';';
+    }
+    kki::string str(data_size, data.data());
+    constexpr kki::char_set delimiters(",;:|");
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    for (size_t pos = str.find_if([](char c){ return c == ',' || c == ';' || c == ':' || c == '|'; }); pos != kki::string::npos;
+         pos = str.find_if([](char c){ return c == ',' || c == ';' || c == ':' || c == '|'; }, pos + 1)){
+        ++total_1;
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2{0};
+    for (size_t pos = str.find_first_of(delimiters); pos != kki::string::npos; pos = str.find_first_of(delimiters, pos + 1)){
+        ++total_2;
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    // Whitespace separated words
+    for (size_t i = 0; i < data_size; i += 97){
+        data[i] = ' ';
+    }
+    kki::string words(data_size, data.data());
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    size_t total_3 = words.split().size();
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Find if          " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Find first of    " << total_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Split whitespace " << total_3 << " " << (end3 - begin3).count() << std::endl;
+}
+
+void test_parallel(){
+    const size_t data_size = 100000000;
+    std::vector<char> data = random_corpus(data_size);
+    kki::string str(data_size, data.data());
+    const size_t threads = std::thread::hardware_concurrency();
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1 = str.find_all('a').size() + str.find_all("ab").size() + str.count('b');
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2 = kki::parallel::find_all(str, 'a', threads).size() + kki::parallel::find_all(str, "ab", threads).size()
+                   + kki::parallel::count(str, 'b', threads);
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Serial        " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Parallel (" << threads << ") " << total_2 << " " << (end2 - begin2).count() << std::endl;
+}
+
+void test_rfind(){
+    const size_t data_size = 10000000;
+    std::vector<char> data = random_corpus(data_size);
+    // Only occurrence of the needle close to the start
+    memcpy(data.data() + 1000, "/needle_in_the_haystack", 23);
+    kki::string str(data_size, data.data());
+    std::string std_str(data.data(), data_size);
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    for (size_t i = 0; i < 10; ++i){
+        total_1 += str.find_all('/').back();
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2{0};
+    for (size_t i = 0; i < 10; ++i){
+        total_2 += str.rfind('/');
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    size_t total_3{0};
+    for (size_t i = 0; i < 10; ++i){
+        total_3 += std_str.rfind("needle_in_the_haystack");
+    }
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    auto begin4 = std::chrono::high_resolution_clock::now();
+    size_t total_4{0};
+    for (size_t i = 0; i < 10; ++i){
+        total_4 += str.rfind("needle_in_the_haystack");
+    }
+    auto end4 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Find all back " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Rfind char    " << total_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Rfind std     " << total_3 << " " << (end3 - begin3).count() << std::endl;
+    std::cout << "Rfind         " << total_4 << " " << (end4 - begin4).count() << std::endl;
+}
+
+void test_ifind(){
+    const size_t data_size = 10000000;
+    std::vector<char> data = random_corpus(data_size);
+    kki::string str(data_size, data.data());
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1 = str.applied([](char c){ return static_cast<char>(tolower(c)); }).find_all("abc").size();
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2 = str.ifind_all("ABC").size();
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    kki::string copy = str.clone();
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    size_t total_3 = str.iequals(copy);
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Applied find all " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Ifind all        " << total_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Iequals          " << total_3 << " " << (end3 - begin3).count() << std::endl;
+}
+
+void test_small_strings(){
+    kki::random rand(0);
+    const size_t keys = 1000000;
+    std::vector<char> data;
+    data.reserve(keys * 12);
+    for(unsigned i = 0; i < keys; ++i){
+        for (size_t j = 0; j < 11; ++j){
+            data.emplace_back(rand.random_alnum());
+        }
+        data.emplace_back(',');
+    }
+    kki::string str(data.size(), data.data());
+
+    // Short keys built one by one
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    {
+        std::vector<kki::string> res;
+        res.reserve(keys);
+        for (size_t i = 0; i < keys; ++i){
+            res.emplace_back(11, data.data() + i * 12);
+        }
+        total_1 = res.size();
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    // Short fields sliced out of one big string
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2 = str.split(',').size();
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Construct " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Split     " << total_2 << " " << (end2 - begin2).count() << std::endl;
+}
+
+// Allocations of the containers measured by test_allocations and test_arena
+static size_t container_allocations{0};
+
+// Standard allocator counting its allocations in container_allocations
+template<typename T>
+struct counting_allocator{
+    using value_type = T;
+
+    counting_allocator() = default;
+    template<typename T_other>
+    counting_allocator(const counting_allocator<T_other>&){}
+
+    T* allocate(size_t n){
+        ++container_allocations;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n){
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename T_other>
+    bool operator==(const counting_allocator<T_other>&) const{
+        return true;
+    }
+    template<typename T_other>
+    bool operator!=(const counting_allocator<T_other>&) const{
+        return false;
+    }
+};
+
+// Heap allocations of buffers and measured containers
+// Build with KKI_COUNT_ALLOCATIONS to include the buffers, the other benchmarks are not affected either way
+size_t allocations(){
+    return kki::buffer::allocations() + container_allocations;
+}
+
+void test_allocations(){
+#if !defined(KKI_COUNT_ALLOCATIONS)
+    std::cout << "Buffer allocations are not counted, build with KKI_COUNT_ALLOCATIONS" << std::endl;
+#endif
+    const size_t strings = 100000;
+    std::vector<char> data;
+    for (size_t i = 0; i < strings; ++i){
+        data.insert(data.end(), 40, static_cast<char>('a' + i % 26));
+        data.emplace_back(',');
+    }
+    kki::string str(data.size(), data.data());
+    std::vector<kki::string, counting_allocator<kki::string>> res;
+    res.reserve(strings);
+
+    // Long strings allocate one buffer holding the reference count and the chars
+    size_t before = allocations();
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < strings; ++i){
+        res.emplace_back(40, data.data() + i * 41);
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+    size_t construct = allocations() - before;
+    res.clear();
+
+    // Copies share the chars
+    before = allocations();
+    for (size_t i = 0; i < strings; ++i){
+        res.push_back(str);
+    }
+    size_t copy = allocations() - before;
+    res.clear();
+
+    // Fields share the chars of the split string, only the result is allocated
+    before = allocations();
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t fields = str.split<counting_allocator<kki::string>>(',').size();
+    auto end2 = std::chrono::high_resolution_clock::now();
+    size_t split = allocations() - before;
+
+    std::cout << "Allocations per constructor " << static_cast<double>(construct) / strings << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Allocations per copy        " << static_cast<double>(copy) / strings << std::endl;
+    std::cout << "Allocations per split       " << split << " for " << fields << " fields " << (end2 - begin2).count() << std::endl;
+}
+
+// Build with KKI_STRING_SINGLE_THREADED to compare against the plain reference count
+void test_refcount_policy(){
+#if defined(KKI_STRING_SINGLE_THREADED)
+    const char* policy = "plain ";
+#else
+    const char* policy = "atomic";
+#endif
+    kki::random rand(0);
+    // 10 MB of fields too long to be stored inline, so every field shares the buffer
+    std::vector<char> data;
+    data.reserve(10 << 20);
+    while (data.size() + 33 <= (10 << 20)){
+        for (size_t j = 0; j < 32; ++j){
+            data.emplace_back(rand.random_alnum());
+        }
+        data.emplace_back(',');
+    }
+    kki::string str(data.size(), data.data());
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    auto fields = str.split(',');
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    // Copying and dropping every field
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total{0};
+    for (size_t i = 0; i < 10; ++i){
+        std::vector<kki::string> copies(fields.begin(), fields.end());
+        total += copies.size();
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Split " << policy << " " << fields.size() << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Copy  " << policy << " " << total << " " << (end2 - begin2).count() << std::endl;
+}
+
+void test_arena(){
+    kki::random rand(0);
+    const size_t records = 200000;
+    // Records of four fields, long enough not to be stored inline
+    std::vector<char> line;
+    for (size_t i = 0; i < 4; ++i){
+        for (size_t j = 0; j < 30; ++j){
+            line.emplace_back(rand.random_alnum());
+        }
+        line.emplace_back(',');
+    }
+    line.pop_back();
+
+    size_t before = allocations();
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    for (size_t i = 0; i < records; ++i){
+        kki::string record(line.size(), line.data());
+        total_1 += record.split<counting_allocator<kki::string>>(',').size();
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+    size_t heap = allocations() - before;
+
+    // Everything of a record is dropped at once by resetting the arena
+    kki::string_arena arena;
+    before = allocations();
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2{0};
+    for (size_t i = 0; i < records; ++i){
+        kki::string record(line.size(), line.data(), arena);
+        total_2 += record.split(',', arena).size();
+        arena.reset();
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+    size_t arena_allocations = allocations() - before;
+
+    std::cout << "Heap  " << total_1 << " " << heap << " allocations " << (end1 - begin1).count() << std::endl;
+    // The arena's own blocks come from the heap once and are kept across reset()
+    std::cout << "Arena " << total_2 << " " << arena_allocations << " allocations " << arena.capacity() << " bytes of blocks " << (end2 - begin2).count() << std::endl;
+}
+
+void test_map_file(){
+    const char* path = "kki_map_file_test.txt";
+    {
+        kki::random rand(0);
+        std::ofstream out(path, std::ios::binary);
+        for (size_t i = 0; i < 1000000; ++i){
+            for (size_t j = 0; j < 40; ++j){
+                out << rand.random_alnum();
+            }
+            out << '\n';
+        }
+    }
+
+    // Copying the whole file into memory first
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        kki::string str(data.size(), data.data());
+        total_1 = str.split('\n').size();
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    // Lines share the mapping
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2{0};
+    {
+        kki::string str = kki::string::map_file(path, kki::access_hint::sequential);
+        total_2 = str.split('\n').size();
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::remove(path);
+    std::cout << "Read " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Map  " << total_2 << " " << (end2 - begin2).count() << std::endl;
+}
+
+void test_line_reader(){
+    const char* path = "kki_line_reader_test.txt";
+    {
+        kki::random rand(0);
+        std::ofstream out(path, std::ios::binary);
+        for (size_t i = 0; i < 1000000; ++i){
+            for (size_t j = 0, len = 10 + i % 60; j < len; ++j){
+                out << rand.random_alnum();
+            }
+            out << '\n';
+        }
+    }
+
+    // Same loop as main, the lines are summed instead of printed
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t total_1{0};
+    {
+        std::ifstream file(path);
+        kki::string s;
+        while (s.getline(file)){
+            total_1 += s.size();
+        }
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t total_2{0};
+    {
+        std::ifstream file(path, std::ios::binary);
+        kki::line_reader reader(file);
+        kki::string s;
+        while (reader.getline(s)){
+            total_2 += s.size();
+        }
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::remove(path);
+    std::cout << "Getline     " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Line reader " << total_2 << " " << (end2 - begin2).count() << std::endl;
+}
+
+void test_string_pool(){
+    kki::random rand(0);
+    // Few distinct values repeated over many records, as field names or enum like values
+    std::vector<std::string> values;
+    for (size_t i = 0; i < 16; ++i){
+        std::string value = "status_value_of_the_record_";
+        value += rand.random_alnum();
+        values.push_back(value);
+    }
+    std::vector<size_t> order;
+    for (size_t i = 0; i < 1000000; ++i){
+        order.push_back(rand.random_index(values.size()));
+    }
+
+    std::vector<kki::string> plain;
+    plain.reserve(order.size());
+    for (size_t i : order){
+        plain.emplace_back(values[i].size(), values[i].data());
+    }
+    kki::string_pool pool;
+    std::vector<kki::string> interned;
+    interned.reserve(order.size());
+    for (size_t i : order){
+        interned.push_back(pool.intern(values[i].data(), values[i].size()));
+    }
+
+    // Counting the records equal to the first one and hashing all of them
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t equal_1{0}, hash_1{0};
+    for (const auto& s : plain){
+        equal_1 += s == plain[0];
+        hash_1 += s.hash();
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t equal_2{0}, hash_2{0};
+    for (const auto& s : interned){
+        equal_2 += s == interned[0];
+        hash_2 += s.hash();
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    auto stats = pool.stats();
+    std::cout << "Plain    " << equal_1 << " " << hash_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Interned " << equal_2 << " " << hash_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Pool " << stats.strings << " strings " << stats.stored_bytes << " bytes stored " << stats.saved_bytes << " bytes saved" << std::endl;
+}
+
+void test_rope_builder(){
+    const size_t lines = 2000000;
+    const char* line = "a line of a very large report with a number: ";
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    kki::string_builder builder;
+    for (size_t i = 0; i < lines; ++i){
+        builder << line << i << '\n';
+    }
+    size_t total_1 = builder.to_string().size();
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    kki::rope_builder rope;
+    for (size_t i = 0; i < lines; ++i){
+        rope << line << i << '\n';
+    }
+    size_t total_2 = rope.to_string().size();
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    // Edits in the middle of the report
+    const size_t edits = 200;
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < edits; ++i){
+        builder(builder.size() / 2) = "inserted ";
+    }
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    auto begin4 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < edits; ++i){
+        rope.insert(rope.size() / 2, "inserted ");
+    }
+    auto end4 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Append builder " << total_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Append rope    " << total_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Insert builder " << builder.size() << " " << (end3 - begin3).count() << std::endl;
+    std::cout << "Insert rope    " << rope.size() << " " << (end4 - begin4).count() << std::endl;
+}
+
+void test_concatenation(){
+    const size_t pieces = 20000;
+    const char* piece = "a piece of text ";
+
+    // Repeated += on the same string
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    kki::string str;
+    for (size_t i = 0; i < pieces; ++i){
+        str += piece;
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    std::string std_str;
+    for (size_t i = 0; i < pieces; ++i){
+        std_str += piece;
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    // Builder to string, copied and then handed over
+    kki::string_builder builder;
+    for (size_t i = 0; i < pieces * 100; ++i){
+        builder << piece;
+    }
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    size_t total_3 = builder.to_string().size();
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    auto begin4 = std::chrono::high_resolution_clock::now();
+    size_t total_4 = std::move(builder).to_string().size();
+    auto end4 = std::chrono::high_resolution_clock::now();
+
+    // string + string
+    auto begin5 = std::chrono::high_resolution_clock::now();
+    size_t total_5{0};
+    for (size_t i = 0; i < pieces; ++i){
+        total_5 += (str.substr(0, 100) + piece).release().size();
+    }
+    auto end5 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "+= kki      " << str.size() << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "+= std      " << std_str.size() << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "to_string   " << total_3 << " " << (end3 - begin3).count() << std::endl;
+    std::cout << "moved       " << total_4 << " " << (end4 - begin4).count() << std::endl;
+    std::cout << "+ released  " << total_5 << " " << (end5 - begin5).count() << std::endl;
+}
+
+void test_hash(){
+    kki::random rand(0);
+    std::vector<kki::string> words;
+    for (size_t i = 0; i < 1000000; ++i){
+        std::string word;
+        const size_t len = 1 + rand.random_index(64);
+        for (size_t j = 0; j < len; ++j){
+            word += rand.random_alnum();
+        }
+        words.emplace_back(word.size(), word.data());
+    }
+
+    // The polynomial hash used before, two modulo operations per char
+    auto polynomial = [](const char* data, size_t len){
+        const size_t p = 131, m = 4294967291;
+        size_t total = 0, current_multiplier = 1;
+        for (size_t i = 0; i < len; ++i){
+            total = (total + current_multiplier * data[i]) % m;
+            current_multiplier = (current_multiplier * p) % m;
+        }
+        return total;
+    };
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t sum_1{0};
+    for (const auto& w : words){
+        sum_1 += polynomial(w.data(), w.size());
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t sum_2{0};
+    for (const auto& w : words){
+        sum_2 += kki::string::hash(w.data(), w.size());
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    // Lookups of every word in a table holding all of them
+    std::unordered_map<kki::string, size_t> table;
+    for (size_t i = 0; i < words.size(); ++i){
+        table.emplace(words[i], i);
+    }
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    size_t found{0};
+    for (const auto& w : words){
+        found += table.count(w);
+    }
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Polynomial " << sum_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Word hash  " << sum_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Lookups    " << found << " " << (end3 - begin3).count() << std::endl;
+}
+
+void test_string_switch(){
+    static constexpr auto keywords = kki::make_string_switch("select", "from", "where", "group", "order", "by", "having",
+                                                             "limit", "offset", "join", "inner", "outer", "left", "right");
+    kki::random rand(0);
+    std::vector<kki::string> tokens;
+    for (size_t i = 0; i < 1000000; ++i){
+        // Every fourth token is not a keyword
+        if (rand.random_index(4) == 0){
+            tokens.emplace_back("identifier");
+        }
+        else{
+            tokens.emplace_back(keywords.key(rand.random_index(keywords.size())));
+        }
+    }
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t sum_1{0};
+    for (const auto& t : tokens){
+        size_t index = keywords.size();
+        for (size_t k = 0; k < keywords.size(); ++k){
+            if (t == keywords.key(k)){
+                index = k;
+                break;
+            }
+        }
+        sum_1 += index;
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    std::unordered_map<kki::string, size_t> table;
+    for (size_t k = 0; k < keywords.size(); ++k){
+        table.emplace(keywords.key(k), k);
+    }
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t sum_2{0};
+    for (const auto& t : tokens){
+        auto i = table.find(t);
+        sum_2 += i == table.end() ? keywords.size() : i->second;
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    size_t sum_3{0};
+    for (const auto& t : tokens){
+        sum_3 += keywords.find(t.data(), t.size());
+    }
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    // not_found taken by reference, e.g. by std::min, needs its definition
+    size_t misses{0};
+    for (const auto& t : tokens){
+        misses += std::min(keywords.find(t), keywords.not_found) == keywords.not_found;
+    }
+
+    std::cout << "Compare chain " << sum_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Hash map      " << sum_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Switch        " << sum_3 << " " << misses << " misses " << (end3 - begin3).count() << std::endl;
+}
+
+void test_transform(){
+    kki::random rand(0);
+    std::string text;
+    for (size_t i = 0; i < 1 << 24; ++i){
+        text += rand.random_alnum();
+    }
+    kki::string str(text.size(), text.data());
+    const std::function<char(char)> upper_function = [](char c){ return c >= 'a' && c <= 'z' ? static_cast<char>(c - 32) : c; };
+
+    // The old way, one indirect call per char over a clone
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    kki::string res_1 = str.clone();
+    res_1.apply(upper_function);
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    kki::string res_2 = str.applied([](char c){ return c >= 'a' && c <= 'z' ? static_cast<char>(c - 32) : c; });
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    kki::string res_3 = str.applied(kki::transform::upper());
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    // ROT13 through a translation table
+    kki::transform::table rot13([](char c){
+        if (c >= 'a' && c <= 'z'){
+            return static_cast<char>('a' + (c - 'a' + 13) % 26);
+        }
+        if (c >= 'A' && c <= 'Z'){
+            return static_cast<char>('A' + (c - 'A' + 13) % 26);
+        }
+        return c;
+    });
+    auto begin5 = std::chrono::high_resolution_clock::now();
+    kki::string res_5 = str.applied(rot13);
+    auto end5 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "std::function " << (res_1 == res_3) << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "Lambda        " << (res_2 == res_3) << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "Upper         " << res_3.size() << " " << (end3 - begin3).count() << std::endl;
+    std::cout << "Table         " << res_5.size() << " " << (end5 - begin5).count() << std::endl;
+}
+
+void test_sort_strings(){
+    kki::random rand(0);
+    // Keys sharing long prefixes, like paths or URLs
+    const char* prefixes[] = {"https://example.com/products/category/", "https://example.com/users/profile/", "/var/log/application/service/"};
+    std::vector<kki::string> keys;
+    for (size_t i = 0; i < 2000000; ++i){
+        std::string key = prefixes[rand.random_index(3)];
+        const size_t len = 4 + rand.random_index(12);
+        for (size_t j = 0; j < len; ++j){
+            key += rand.random_alnum();
+        }
+        keys.emplace_back(key.size(), key.data());
+    }
+
+    std::vector<kki::string> keys_1 = keys;
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    std::sort(keys_1.begin(), keys_1.end());
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    std::vector<kki::string> keys_2 = keys;
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    kki::sort_strings(keys_2);
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::vector<kki::string> keys_3 = keys;
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    kki::parallel::sort_strings(keys_3);
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "std::sort        " << std::is_sorted(keys_1.begin(), keys_1.end()) << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "sort_strings     " << (keys_2 == keys_1) << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "parallel strings " << (keys_3 == keys_1) << " " << (end3 - begin3).count() << std::endl;
+}
+
+void test_split_into(){
+    // About 10 MB of comma separated records, one per line, of 4 to 11 fields of up to 11 chars
+    std::vector<char> text = random_corpus(10 << 20);
+    kki::random rand(1);
+    // Fields of the current record and how many it gets
+    size_t field = 0;
+    size_t record = 4 + rand.random_index(8);
+    for (size_t i = rand.random_index(12); i < text.size(); i += 1 + rand.random_index(12)){
+        if (++field == record){
+            text[i] = '\n';
+            field = 0;
+            record = 4 + rand.random_index(8);
+        }
+        else{
+            text[i] = ',';
+        }
+    }
+    kki::string data(text.size(), text.data());
+    std::vector<kki::string> lines = data.split('\n');
+
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t fields_1{0};
+    for (const auto& line : lines){
+        fields_1 += line.split(',').size();
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t fields_2{0};
+    std::vector<kki::string> fields;
+    for (const auto& line : lines){
+        fields_2 += line.split_into(fields, ',');
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    auto begin3 = std::chrono::high_resolution_clock::now();
+    size_t fields_3{0};
+    std::vector<std::pair<size_t, size_t>> offsets;
+    for (const auto& line : lines){
+        fields_3 += line.split_offsets(offsets, ',');
+    }
+    auto end3 = std::chrono::high_resolution_clock::now();
+
+    // The whole buffer at once, into the capacity left by a first pass
+    data.split_offsets(offsets, ',');
+    auto begin4 = std::chrono::high_resolution_clock::now();
+    const size_t fields_4 = data.split_offsets(offsets, ',');
+    auto end4 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "split         " << fields_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "split_into    " << fields_2 << " " << (end2 - begin2).count() << std::endl;
+    std::cout << "split_offsets " << fields_3 << " " << (end3 - begin3).count() << std::endl;
+    std::cout << "Whole buffer  " << fields_4 << " " << (end4 - begin4).count() << std::endl;
+}
+
+void test_csv_reader(){
+    kki::random rand(0);
+    // About 20 MB of records, some fields quoted
+    std::string text;
+    while (text.size() < 20 << 20){
+        for (size_t f = 0; f < 8; ++f){
+            const bool quoted = rand.random_index(8) == 0;
+            if (quoted){
+                text += '"';
+            }
+            const size_t len = rand.random_index(16);
+            for (size_t j = 0; j < len; ++j){
+                text += rand.random_alnum();
+            }
+            if (quoted){
+                text += " with, comma\"";
+            }
+            text += f == 7 ? '\n' : ',';
+        }
+    }
+    std::istringstream stream(text);
+    kki::string data(text.size(), text.data());
+
+    // getline and split, quoted commas are split wrongly
+    auto begin1 = std::chrono::high_resolution_clock::now();
+    size_t fields_1{0};
+    kki::string line;
+    while (line.getline(stream)){
+        fields_1 += line.split(',').size();
+    }
+    auto end1 = std::chrono::high_resolution_clock::now();
+
+    auto begin2 = std::chrono::high_resolution_clock::now();
+    size_t fields_2{0}, rows{0};
+    kki::csv_reader reader(data);
+    std::vector<kki::string> fields;
+    while (reader.read_row(fields)){
+        fields_2 += fields.size();
+        ++rows;
+    }
+    auto end2 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "getline + split " << fields_1 << " " << (end1 - begin1).count() << std::endl;
+    std::cout << "csv_reader      " << fields_2 << " " << rows << " rows " << (end2 - begin2).count() << std::endl;
 }
 
 void test_switch(){